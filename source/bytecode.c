@@ -0,0 +1,295 @@
+// This code is licensed under the MIT Open Source License.
+
+// Copyright (c) 2015 Ruairidh Carmichael - ruairidhcarmichael@live.co.uk
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Only depends on Lua and the C library, tools/luacache.c builds it on the host
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "libs/lua/lauxlib.h"
+#include "bytecode.h"
+
+struct CacheHeader {
+
+	char magic[4];
+	uint32_t size; // Source size
+	uint32_t mtime; // Source mtime, 0 to always check the hash
+	uint32_t hash; // FNV-1a of the source
+
+};
+
+static const char cacheMagic[4] = { 'L', 'P', 'B', 'C' };
+
+static uint32_t hashBytes(const char *data, size_t size) {
+
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ (unsigned char)data[i]) * 16777619u;
+	}
+
+	return hash;
+
+}
+
+static void cachePath(const char *filename, char *path, size_t size) {
+
+	// "./foo.lua" from package.path and "foo.lua" are the same file
+	while (filename[0] == '.' && filename[1] == '/') filename += 2;
+
+	snprintf(path, size, BYTECODE_CACHE_DIR "/%08lx.luac", (unsigned long)hashBytes(filename, strlen(filename)));
+
+}
+
+static char *readFile(const char *filename, size_t *size) {
+
+	FILE *file = fopen(filename, "rb");
+	if (!file) return NULL;
+
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	char *data = length >= 0 ? malloc(length + 1) : NULL;
+
+	if (data && fread(data, 1, length, file) != (size_t)length) {
+		free(data);
+		data = NULL;
+	}
+
+	fclose(file);
+
+	if (data) *size = length;
+
+	return data;
+
+}
+
+static int cacheWriter(lua_State *L, const void *p, size_t size, void *ud) {
+
+	return fwrite(p, 1, size, ud) != size;
+
+}
+
+// Dumps the function on top of the stack, a cache that can't be written is not an error
+static void cacheWrite(lua_State *L, const char *path, const struct CacheHeader *header) {
+
+	FILE *file = fopen(path, "wb");
+
+	if (!file) {
+		mkdir(BYTECODE_CACHE_DIR, 0777);
+		file = fopen(path, "wb");
+		if (!file) return;
+	}
+
+	int failed = fwrite(header, sizeof(*header), 1, file) != 1;
+	if (!failed) failed = lua_dump(L, cacheWriter, file);
+
+	if (fclose(file) != 0 || failed) remove(path);
+
+}
+
+static int compileSource(lua_State *L, const char *filename, const char *source, size_t size) {
+
+	const char *code = source;
+
+	// Skip a #! line like luaL_loadfile, keeping the newline so line numbers match
+	if (size > 0 && code[0] == '#') {
+		while (size > 0 && *code != '\n') {
+			code++;
+			size--;
+		}
+	}
+
+	lua_pushfstring(L, "@%s", filename);
+	int status = luaL_loadbuffer(L, code, size, lua_tostring(L, -1));
+	lua_remove(L, -2);
+
+	return status;
+
+}
+
+static int loadSource(lua_State *L, const char *filename, const char *path, uint32_t mtime) {
+
+	size_t size;
+	char *source = readFile(filename, &size);
+
+	if (!source) return luaL_loadfile(L, filename); // Same error message as without a cache
+
+	int status = compileSource(L, filename, source, size);
+
+	if (status == 0) {
+		struct CacheHeader header;
+		memcpy(header.magic, cacheMagic, 4);
+		header.size = size;
+		header.mtime = mtime;
+		header.hash = hashBytes(source, size);
+		cacheWrite(L, path, &header);
+	}
+
+	free(source);
+
+	return status;
+
+}
+
+int bytecodeLoadFile(lua_State *L, const char *filename) { // Like luaL_loadfile, through the cache
+
+	char path[64];
+	cachePath(filename, path, sizeof(path));
+
+	struct stat st;
+	if (stat(filename, &st) != 0) return luaL_loadfile(L, filename);
+
+	FILE *file = fopen(path, "rb");
+	if (!file) return loadSource(L, filename, path, st.st_mtime);
+
+	struct CacheHeader header;
+	bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+		memcmp(header.magic, cacheMagic, 4) == 0 && header.size == (uint32_t)st.st_size;
+
+	// Filesystems without mtimes and copied release caches fall back to the hash
+	if (valid && !(header.mtime != 0 && header.mtime == (uint32_t)st.st_mtime)) {
+		size_t size;
+		char *source = readFile(filename, &size);
+		valid = source && hashBytes(source, size) == header.hash;
+		free(source);
+	}
+
+	char *code = NULL;
+	size_t size = 0;
+
+	if (valid) {
+		long start = ftell(file);
+		fseek(file, 0, SEEK_END);
+		size = ftell(file) - start;
+		fseek(file, start, SEEK_SET);
+
+		code = malloc(size);
+		if (code && fread(code, 1, size, file) != size) {
+			free(code);
+			code = NULL;
+		}
+	}
+
+	fclose(file);
+
+	if (code) {
+
+		lua_pushfstring(L, "@%s", filename);
+		int status = luaL_loadbuffer(L, code, size, lua_tostring(L, -1));
+		lua_remove(L, -2);
+
+		free(code);
+
+		if (status == 0) return 0;
+
+		lua_pop(L, 1); // Written by another Lua build, recompile
+
+	}
+
+	return loadSource(L, filename, path, st.st_mtime);
+
+}
+
+int bytecodeCompile(lua_State *L, const char *filename, int keepMtime) { // Writes the cache for filename, leaves the chunk on the stack
+
+	char path[64];
+	cachePath(filename, path, sizeof(path));
+
+	struct stat st;
+	if (stat(filename, &st) != 0) return luaL_loadfile(L, filename);
+
+	return loadSource(L, filename, path, keepMtime ? st.st_mtime : 0);
+
+}
+
+static int bytecodeLoader(lua_State *L) { // package.loaders[2]
+
+	const char *name = luaL_checkstring(L, 1);
+
+	name = luaL_gsub(L, name, ".", "/");
+
+	lua_getglobal(L, "package");
+	lua_getfield(L, -1, "path");
+
+	const char *path = lua_tostring(L, -1);
+	if (!path) luaL_error(L, "'package.path' must be a string");
+
+	lua_pushstring(L, ""); // Files tried, for the error message
+
+	while (*path) {
+
+		const char *end = strchr(path, ';');
+		if (!end) end = path + strlen(path);
+
+		if (end > path) {
+
+			lua_pushlstring(L, path, end - path);
+			const char *filename = luaL_gsub(L, lua_tostring(L, -1), "?", name);
+			lua_remove(L, -2);
+
+			FILE *file = fopen(filename, "r");
+
+			if (file) {
+
+				fclose(file);
+
+				if (bytecodeLoadFile(L, filename) != 0) {
+					luaL_error(L, "error loading module '%s' from file '%s':\n\t%s",
+						lua_tostring(L, 1), filename, lua_tostring(L, -1));
+				}
+
+				return 1;
+
+			}
+
+			lua_pushfstring(L, "\n\tno file '%s'", filename);
+			lua_remove(L, -2);
+			lua_concat(L, 2);
+
+		}
+
+		path = *end ? end + 1 : end;
+
+	}
+
+	return 1;
+
+}
+
+void bytecodeInstallLoader(lua_State *L) { // require goes through the cache
+
+	lua_getglobal(L, "package");
+	lua_getfield(L, -1, "loaders");
+
+	lua_pushcfunction(L, bytecodeLoader);
+	lua_rawseti(L, -2, 2);
+
+	lua_pop(L, 2);
+
+}
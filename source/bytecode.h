@@ -0,0 +1,38 @@
+// This code is licensed under the MIT Open Source License.
+
+// Copyright (c) 2015 Ruairidh Carmichael - ruairidhcarmichael@live.co.uk
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef BYTECODE_H_INCLUDED
+#define BYTECODE_H_INCLUDED
+
+#include "libs/lua/lua.h"
+
+// Compiled chunks are kept in BYTECODE_CACHE_DIR, one file per source
+// named after a hash of its path. A cache file is used while the source
+// has the same size and either the same mtime or the same content hash.
+
+#define BYTECODE_CACHE_DIR ".luacache"
+
+int bytecodeLoadFile(lua_State *L, const char *filename);
+int bytecodeCompile(lua_State *L, const char *filename, int keepMtime);
+void bytecodeInstallLoader(lua_State *L);
+
+#endif
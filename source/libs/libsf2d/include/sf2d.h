@@ -40,11 +40,33 @@ extern "C" {
  */
 #define SF2D_TEMPPOOL_DEFAULT_SIZE 0x80000
 
+/**
+ * @brief Minimum size of a temporary pool overflow block
+ */
+#define SF2D_TEMPPOOL_OVERFLOW_SIZE 0x10000
+
 /**
  * @brief Default depth (Z coordinate) to draw the textures to
  */
 #define SF2D_DEFAULT_DEPTH 0.5f
 
+/**
+ * @brief Value of a packed texture coordinate that represents 1.0
+ * @note A power of two, so texel coordinates of textures up to 1024x1024 are exact
+ */
+#define SF2D_PACKED_UV_ONE 0x4000
+
+/**
+ * @brief Sub-pixel steps of the packed positions made by sf2d_draw_texture_sprites_color
+ */
+#define SF2D_PACKED_SUBPIXELS 4
+
+/**
+ * @brief Maximum number of sprites sf2d_draw_texture_sprites submits in one draw call
+ * @note Keeps each vertex allocation within a temporary pool overflow block
+ */
+#define SF2D_SPRITES_PER_DRAW 256
+
 // Enums
 
 /**
@@ -119,6 +141,63 @@ typedef struct {
 	sf2d_vector_2f texcoord;  /**< Texture coordinates of the vertex */
 } sf2d_vertex_pos_tex;
 
+/**
+ * @brief Represents a packed vertex containing position, texture coordinates
+ *        (16-bit integers) and color (unsigned int). 12 bytes instead of 20.
+ */
+
+typedef struct {
+	s16 x;      /**< X position of the vertex, in whole pixels, sub-pixels for sprite arrays, any unit for vertex arrays */
+	s16 y;      /**< Y position of the vertex, in whole pixels, sub-pixels for sprite arrays, any unit for vertex arrays */
+	s16 u;      /**< U texture coordinate, SF2D_PACKED_UV_ONE being 1.0 */
+	s16 v;      /**< V texture coordinate, SF2D_PACKED_UV_ONE being 1.0 */
+	u32 color;  /**< Color of the vertex */
+} sf2d_vertex_packed;
+
+/**
+ * @brief Represents one sprite of a sf2d_draw_texture_sprites batch
+ */
+
+typedef struct {
+	float x;      /**< X coordinate of the sprite's origin */
+	float y;      /**< Y coordinate of the sprite's origin */
+	float rad;    /**< Rotation around the origin, in radians */
+	float sx;     /**< Horizontal scale */
+	float sy;     /**< Vertical scale */
+	float ox;     /**< X offset of the origin inside the sprite */
+	float oy;     /**< Y offset of the origin inside the sprite */
+	int tex_x;    /**< X coordinate of the texture part */
+	int tex_y;    /**< Y coordinate of the texture part */
+	int tex_w;    /**< Width of the texture part */
+	int tex_h;    /**< Height of the texture part */
+} sf2d_sprite;
+
+/**
+ * @brief Temporary pool usage statistics, accumulated since the
+ *        last sf2d_reset_pool_stats call
+ */
+
+typedef struct {
+	u32 size;         /**< Current size of the main pool */
+	u32 used;         /**< Bytes in use right now, overflow blocks included */
+	u32 high_water;   /**< Peak bytes in use */
+	u32 allocations;  /**< Number of allocations */
+	u32 overflows;    /**< Allocations served by an overflow block */
+	u32 failures;     /**< Allocations that returned NULL */
+} sf2d_pool_stats;
+
+/**
+ * @brief Drawing statistics of a frame
+ */
+
+typedef struct {
+	u32 draw_calls;      /**< Number of GPU draw calls */
+	u32 vertices;        /**< Number of vertices submitted */
+	u32 texture_binds;   /**< Number of textures bound */
+	u32 texenv_changes;  /**< Number of texture combiner (tex-env) setups */
+	u32 pool_bytes;      /**< Peak temporary pool use, see sf2d_get_pool_stats */
+} sf2d_stats;
+
 /**
  * @brief Represents a texture
  */
@@ -148,6 +227,7 @@ int sf2d_init();
  * @brief Initializates the library (with advanced settings)
  * @param gpucmd_size the size of the GPU FIFO
  * @param temppool_size the size of the temporary pool
+ * @note Two FIFOs and two pools of these sizes are allocated, one per frame in flight
  * @return Whether the initialization has been successful or not
  */
 int sf2d_init_advanced(int gpucmd_size, int temppool_size);
@@ -181,6 +261,50 @@ void sf2d_end_frame();
  */
 void sf2d_swapbuffers();
 
+/**
+ * @brief Waits until the GPU has rendered every ended frame and copied it to the screen
+ * @note sf2d_end_frame doesn't wait for the GPU, so the next frame is built while the
+ *       previous one renders. Call this before modifying or freeing memory the GPU may still read.
+ */
+void sf2d_wait_gpu();
+
+/**
+ * @brief Profiling zone callback, see sf2d_set_zone_callback
+ * @param name the zone name, a string literal
+ * @param begin 1 when the zone starts, 0 when it ends
+ */
+typedef void (*sf2d_zone_callback)(const char *name, int begin);
+
+/**
+ * @brief Sets a callback called around the places where sf2d waits for the GPU
+ *        (rendering, display transfer, clear and VBlank)
+ * @param callback the callback, or NULL to disable it
+ */
+void sf2d_set_zone_callback(sf2d_zone_callback callback);
+
+/**
+ * @brief Sets the model-view transform applied by the vertex shader to everything drawn afterwards
+ * @param m 2x3 row-major affine matrix ({a, b, tx, c, d, ty}), or NULL for the identity
+ * @note The transform is reset to the identity by sf2d_start_frame.
+ *       The uniform is only uploaded when a draw call needs a different matrix.
+ */
+void sf2d_set_transform(const float *m);
+
+/**
+ * @brief Enables or disables the packed vertex format (sf2d_vertex_packed)
+ *        for axis-aligned rectangles and texture draws
+ * @param enable whether to enable or disable the packed vertices
+ * @note Only quads whose corners are whole pixels within the s16 range are packed, the
+ *       rest keep the float format, so nothing drawn moves. Disabled by default.
+ */
+void sf2d_set_vertex_packing(int enable);
+
+/**
+ * @brief Returns whether the packed vertex format is enabled
+ * @return whether the packed vertex format is enabled
+ */
+int sf2d_get_vertex_packing();
+
 /**
  * @brief Enables or disables the VBlank waiting
  * @param enable whether to enable or disable the VBlank waiting
@@ -193,6 +317,27 @@ void sf2d_set_vblank_wait(int enable);
  */
 float sf2d_get_fps();
 
+/**
+ * @brief Returns the number of frames started so far, which numbers the current frame
+ * @return the number of sf2d_start_frame calls
+ */
+u32 sf2d_get_frame_count();
+
+/**
+ * @brief Returns the number of the last frame the GPU has finished rendering
+ * @note Frames are pipelined: linear memory read by a draw in frame n
+ *       (see sf2d_get_frame_count) can be changed once this returns n or more.
+ * @return the frame number, 0 before the first frame is rendered
+ */
+u32 sf2d_get_rendered_frame();
+
+/**
+ * @brief Returns the drawing statistics of the last presented frame, that is,
+ *        of every sf2d_start_frame/sf2d_end_frame pair before the last sf2d_swapbuffers call
+ * @param stats where to store the statistics
+ */
+void sf2d_get_stats(sf2d_stats *stats);
+
 /**
  * @brief Allocates memory from a temporary pool. The pool will be emptied after a sf2d_swapbuffers call
  * @param size the number of bytes to allocate
@@ -223,9 +368,28 @@ unsigned int sf2d_pool_space_free();
 
 /**
  * @brief Empties the temporary pool
+ * @note Overflow blocks are freed here, and if any were needed the main
+ *       pool is grown to the high-water mark so the next frame fits in it
  */
 void sf2d_pool_reset();
 
+/**
+ * @brief Sets whether the temporary pool grows when it runs out of space
+ * @param enable whether to allocate overflow blocks (enabled by default)
+ */
+void sf2d_set_pool_growth(int enable);
+
+/**
+ * @brief Returns the temporary pool usage statistics
+ * @param stats where to store the statistics
+ */
+void sf2d_get_pool_stats(sf2d_pool_stats *stats);
+
+/**
+ * @brief Resets the temporary pool usage statistics
+ */
+void sf2d_reset_pool_stats();
+
 /**
  * @brief Sets the screen clear color
  * @param color the color
@@ -264,6 +428,17 @@ void sf2d_draw_rectangle(int x, int y, int w, int h, u32 color);
  */
 void sf2d_draw_rectangle_rotate(int x, int y, int w, int h, u32 color, float rad);
 
+/**
+ * @brief Draws a rectangle transformed by an affine matrix
+ * @param x x coordinate of the top left corner of the rectangle (before the transform)
+ * @param y y coordinate of the top left corner of the rectangle (before the transform)
+ * @param w rectangle width
+ * @param h rectangle height
+ * @param m 2x3 row-major affine matrix ({a, b, tx, c, d, ty}) applied on top of the current transform (sf2d_set_transform), or NULL
+ * @param color the color to draw the rectangle
+ */
+void sf2d_draw_rectangle_transform(float x, float y, float w, float h, const float *m, u32 color);
+
 /**
  * @brief Draws a filled circle
  * @param x x coordinate of the center of the circle
@@ -273,6 +448,31 @@ void sf2d_draw_rectangle_rotate(int x, int y, int w, int h, u32 color, float rad
  */
 void sf2d_draw_fill_circle(int x, int y, int radius, u32 color);
 
+/**
+ * @brief Draws solid colored triangles
+ * @param positions x, y pairs of the vertices
+ * @param count the number of vertices
+ * @param primitive how the vertices form triangles (GPU_TRIANGLES, GPU_TRIANGLE_STRIP or GPU_TRIANGLE_FAN)
+ * @param color the color to draw the triangles
+ */
+void sf2d_draw_vertices(const float *positions, int count, GPU_Primitive_t primitive, u32 color);
+
+/**
+ * @brief Draws packed vertices kept in linear memory, without copying them
+ * @param texture the texture to draw with, or NULL for vertex colors only
+ * @param vertices the vertices, with positions in whatever units m maps to pixels
+ * @param indices 16-bit indices into vertices, or NULL to draw the vertices in order
+ * @param first the first vertex (or index) to draw
+ * @param count the number of vertices (or indices) to draw
+ * @param primitive how the vertices form triangles (GPU_TRIANGLES, GPU_TRIANGLE_STRIP or GPU_TRIANGLE_FAN)
+ * @param m 2x3 row-major affine matrix ({a, b, tx, c, d, ty}) applied to the packed positions on top of the current transform (sf2d_set_transform), or NULL
+ * @param color the color to blend with the vertex colors
+ * @note The GPU reads the indices relative to the vertices, so they must come after
+ *       them in linear memory, e.g. in the same allocation. Flush both from the data
+ *       cache after writing them.
+ */
+void sf2d_draw_vertices_packed(const sf2d_texture *texture, const sf2d_vertex_packed *vertices, const u16 *indices, int first, int count, GPU_Primitive_t primitive, const float *m, u32 color);
+
 // Texture
 
 /**
@@ -525,6 +725,55 @@ void sf2d_draw_texture_part_rotate_scale(const sf2d_texture *texture, int x, int
  */
 void sf2d_draw_texture_part_rotate_scale_blend(const sf2d_texture *texture, int x, int y, float rad, int tex_x, int tex_y, int tex_w, int tex_h, float x_scale, float y_scale, u32 color);
 
+/**
+ * @brief Draws a part of a texture transformed by an affine matrix
+ * @param texture the texture to draw
+ * @param x the x coordinate to draw the texture to (before the transform)
+ * @param y the y coordinate to draw the texture to (before the transform)
+ * @param tex_x the starting point (x coordinate) where to start drawing
+ * @param tex_y the starting point (y coordinate) where to start drawing
+ * @param tex_w the width to draw from the starting point
+ * @param tex_h the height to draw from the starting point
+ * @param m 2x3 row-major affine matrix ({a, b, tx, c, d, ty}) applied on top of the current transform (sf2d_set_transform), or NULL
+ */
+void sf2d_draw_texture_part_transform(const sf2d_texture *texture, float x, float y, int tex_x, int tex_y, int tex_w, int tex_h, const float *m);
+
+/**
+ * @brief Draws a part of a texture transformed by an affine matrix, with color
+ * @param texture the texture to draw
+ * @param x the x coordinate to draw the texture to (before the transform)
+ * @param y the y coordinate to draw the texture to (before the transform)
+ * @param tex_x the starting point (x coordinate) where to start drawing
+ * @param tex_y the starting point (y coordinate) where to start drawing
+ * @param tex_w the width to draw from the starting point
+ * @param tex_h the height to draw from the starting point
+ * @param m 2x3 row-major affine matrix ({a, b, tx, c, d, ty}) applied on top of the current transform (sf2d_set_transform), or NULL
+ * @param color the color to blend with the texture
+ */
+void sf2d_draw_texture_part_transform_blend(const sf2d_texture *texture, float x, float y, int tex_x, int tex_y, int tex_w, int tex_h, const float *m, u32 color);
+
+/**
+ * @brief Draws many parts of a texture with one draw call per SF2D_SPRITES_PER_DRAW sprites
+ * @param texture the texture to draw
+ * @param sprites the sprites to draw, transformed on the CPU
+ * @param count the number of sprites
+ * @param color the color to blend with the texture
+ * @note The current transform (sf2d_set_transform) applies to every sprite
+ */
+void sf2d_draw_texture_sprites_blend(const sf2d_texture *texture, const sf2d_sprite *sprites, int count, u32 color);
+
+/**
+ * @brief Draws many parts of a texture, each blended with its own color
+ * @param texture the texture to draw
+ * @param sprites the sprites to draw, transformed on the CPU
+ * @param colors the color of each sprite
+ * @param count the number of sprites
+ * @param m 2x3 row-major affine matrix ({a, b, tx, c, d, ty}) applied on top of the current transform (sf2d_set_transform), or NULL
+ * @note Uses packed vertices with positions rounded to a quarter pixel, relative to the
+ *       first sprite of each draw call, so sprites far from (0, 0) keep that precision
+ */
+void sf2d_draw_texture_sprites_color(const sf2d_texture *texture, const sf2d_sprite *sprites, const u32 *colors, int count, const float *m);
+
 /**
  * @brief Draws a texture blended in a certain depth
  * @param texture the texture to draw
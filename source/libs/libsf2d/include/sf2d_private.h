@@ -2,11 +2,18 @@
 #define SF2D_PRIVATE_H
 
 #include <3ds.h>
+#include <math.h>
 #include "sf2d.h"
 
 
 void GPU_SetDummyTexEnv(u8 num);
 
+// Frame statistics
+
+void sf2d_stats_draw(u32 vertices);
+void sf2d_stats_texture_bind();
+void sf2d_stats_texenv();
+
 // Vector operations
 
 void vector_mult_matrix4x4(const float *msrc, const sf2d_vector_3f *vsrc, sf2d_vector_3f *vdst);
@@ -24,6 +31,45 @@ void matrix_swap_xy(float *m);
 void matrix_init_orthographic(float *m, float left, float right, float bottom, float top, float near, float far);
 void matrix_gpu_set_uniform(const float *m, u32 startreg);
 
+// 2x3 affine matrix operations ({a, b, tx, c, d, ty})
+
+void matrix_identity2x3(float *m);
+void matrix_mult2x3(const float *src1, const float *src2, float *dst);
+void matrix_gpu_set_uniform2x3(const float *m, u32 startreg);
+
+static inline int matrix_is_translation2x3(const float *m)
+{
+	return m[0] == 1.0f && m[1] == 0.0f && m[3] == 0.0f && m[4] == 1.0f;
+}
+
+// Model-view transform
+
+void sf2d_apply_transform(const float *local);
+void sf2d_apply_transform_packed(const float *local, float origin_x, float origin_y);
+
+// Packed vertices
+
+static inline s16 sf2d_pack_position(float p)
+{
+	//Clamped to the s16 range, rounded the same way on both sides of zero
+	if (p <= -32768.0f) return -32768;
+	if (p >= 32767.0f) return 32767;
+	return (s16)floorf(p + 0.5f);
+}
+
+static inline int sf2d_packs_exactly(float p)
+{
+	return p >= -32768.0f && p <= 32767.0f && p == floorf(p);
+}
+
+static inline s16 sf2d_pack_texcoord(float t, int pow2)
+{
+	return (s16)(t * SF2D_PACKED_UV_ONE / pow2);
+}
+
+//Returns 0 without drawing when a corner isn't a whole pixel in the s16 range
+int sf2d_draw_quad_packed(float left, float top, float right, float bottom, s16 u0, s16 v0, s16 u1, s16 v1, u32 color, const float *local);
+
 unsigned int next_pow2(unsigned int v);
 
 #endif
@@ -1,27 +1,64 @@
+#include <string.h>
 #include "sf2d.h"
 #include "sf2d_private.h"
 #include "shader_vsh_shbin.h"
 
+// Header of a temporary pool overflow block, the data follows it
+struct pool_block {
+	struct pool_block *next;
+	u32 size;
+	u32 index;
+};
+
+// Temporary memory pool
+struct temp_pool {
+	void *addr;
+	u32 index;
+	u32 size;
+	struct pool_block *overflow;
+	u32 overflow_used;
+};
+
+// Everything a frame needs until the GPU is done with it. There are two of
+// them so the CPU can build a frame while the GPU renders the previous one.
+struct frame_slot {
+	u32 *gpu_cmd;
+	u32 *fb_addr;
+	u32 *depth_fb_addr;
+	struct temp_pool pool;
+	gfxScreen_t screen;
+	gfx3dSide_t side;
+	int render_pending;   // Submitted to the GPU, P3D not waited yet
+	int transfer_pending; // Display transfer issued, PPF not waited yet
+	int clear_pending;    // Memory fill issued, PSC0 not waited yet
+	u32 frame;            // Value of frame_count when the slot was started
+};
 
 static int sf2d_initialized = 0;
 static u32 clear_color = 0;
-static u32 *gpu_cmd = NULL;
 //GPU init variables
 static int gpu_cmd_size = 0;
-// Temporary memory pool
-static void *pool_addr = NULL;
-static u32 pool_index = 0;
-static u32 pool_size = 0;
-//GPU framebuffer address
-static u32 *gpu_fb_addr = NULL;
-//GPU depth buffer address
-static u32 *gpu_depth_fb_addr = NULL;
+//Frame slots, the one being built and its pool
+static struct frame_slot slots[2];
+static int cur_slot = 0;
+static struct temp_pool *pool = &slots[0].pool;
+static int pool_growth = 1;
+static sf2d_pool_stats pool_stats;
+//Drawing statistics: current sf2d frame, frames since the last swap, last presented frame
+static sf2d_stats frame_stats;
+static sf2d_stats swap_stats;
+static sf2d_stats last_stats;
 //VBlank wait
 static int vblank_wait = 1;
+//Packed vertex format
+static int vertex_packing = 0;
 //FPS calculation
 static float current_fps = 0.0f;
 static unsigned int frames = 0;
 static u64 last_time = 0;
+//Number of sf2d_start_frame calls, and the last frame the GPU has rendered
+static u32 frame_count = 0;
+static u32 rendered_frame = 0;
 //Current screen/side
 static gfxScreen_t cur_screen = GFX_TOP;
 static gfx3dSide_t cur_side = GFX_LEFT;
@@ -29,14 +66,31 @@ static gfx3dSide_t cur_side = GFX_LEFT;
 static DVLB_s *dvlb = NULL;
 static shaderProgram_s shader;
 static u32 projection_desc = -1;
+static u32 modelview_desc = -1;
 //Matrix
 static float ortho_matrix_top[4*4];
 static float ortho_matrix_bot[4*4];
+//Model-view transform (2x3): the one set by the user and the one on the GPU
+static float transform_user[2*3];
+static float transform_gpu[2*3];
+//Profiling zone callback
+static sf2d_zone_callback zone_callback = NULL;
 //Apt hook cookie
 static aptHookCookie apt_hook_cookie;
 //Functions
+static void *pool_overflow_memalign(u32 size, u32 alignment);
 static void apt_hook_func(APT_HookType hook, void *param);
 static void reset_gpu_apt_resume();
+static void finish_render(struct frame_slot *slot);
+static void finish_transfer(struct frame_slot *slot);
+static void finish_clear(struct frame_slot *slot);
+static void clear_target(struct frame_slot *slot);
+static void wait_clear(struct frame_slot *slot);
+
+static inline void zone(const char *name, int begin)
+{
+	if (zone_callback) zone_callback(name, begin);
+}
 
 int sf2d_init()
 {
@@ -49,17 +103,25 @@ int sf2d_init_advanced(int gpucmd_size, int temppool_size)
 {
 	if (sf2d_initialized) return 0;
 
-	gpu_fb_addr       = vramMemAlign(400*240*8, 0x100);
-	gpu_depth_fb_addr = vramMemAlign(400*240*8, 0x100);
-	gpu_cmd           = linearAlloc(gpucmd_size * 4);
-	pool_addr         = linearAlloc(temppool_size);
-	pool_size         = temppool_size;
-	gpu_cmd_size      = gpucmd_size;
+	int i;
+	for (i = 0; i < 2; i++) {
+		struct frame_slot *slot = &slots[i];
+		memset(slot, 0, sizeof(*slot));
+		slot->fb_addr       = vramMemAlign(400*240*8, 0x100);
+		slot->depth_fb_addr = vramMemAlign(400*240*8, 0x100);
+		slot->gpu_cmd       = linearAlloc(gpucmd_size * 4);
+		slot->pool.addr     = linearAlloc(temppool_size);
+		slot->pool.size     = temppool_size;
+	}
+	cur_slot     = 0;
+	pool         = &slots[0].pool;
+	gpu_cmd_size = gpucmd_size;
+	sf2d_reset_pool_stats();
 
 	gfxInitDefault();
 	GPU_Init(NULL);
 	gfxSet3D(false);
-	GPU_Reset(NULL, gpu_cmd, gpucmd_size);
+	GPU_Reset(NULL, slots[0].gpu_cmd, gpucmd_size);
 
 	//Setup the shader
 	dvlb = DVLB_ParseFile((u32 *)shader_vsh_shbin, shader_vsh_shbin_size);
@@ -68,6 +130,7 @@ int sf2d_init_advanced(int gpucmd_size, int temppool_size)
 
 	//Get shader uniform descriptors
 	projection_desc = shaderInstanceGetUniformLocation(shader.vertexShader, "projection");
+	modelview_desc = shaderInstanceGetUniformLocation(shader.vertexShader, "modelview");
 
 	shaderProgramUse(&shader);
 
@@ -75,6 +138,12 @@ int sf2d_init_advanced(int gpucmd_size, int temppool_size)
 	matrix_init_orthographic(ortho_matrix_bot, 0.0f, 320.0f, 0.0f, 240.0f, 0.0f, 1.0f);
 	matrix_gpu_set_uniform(ortho_matrix_top, projection_desc);
 
+	float modelview[4*4];
+	matrix_identity4x4(modelview);
+	matrix_gpu_set_uniform(modelview, modelview_desc);
+	matrix_identity2x3(transform_user);
+	matrix_identity2x3(transform_gpu);
+
 	//Register the apt callback hook
 	aptHook(&apt_hook_cookie, apt_hook_func, NULL);
 
@@ -90,6 +159,12 @@ int sf2d_init_advanced(int gpucmd_size, int temppool_size)
 	GPUCMD_FlushAndRun();
 	gspWaitForP3D();
 
+	//Both render targets start cleared
+	for (i = 0; i < 2; i++) {
+		clear_target(&slots[i]);
+		finish_clear(&slots[i]);
+	}
+
 	sf2d_pool_reset();
 
 	sf2d_initialized = 1;
@@ -103,17 +178,28 @@ int sf2d_fini()
 
 	aptUnhook(&apt_hook_cookie);
 
+	sf2d_wait_gpu();
+	finish_clear(&slots[0]);
+	finish_clear(&slots[1]);
+
 	gfxExit();
 	shaderProgramFree(&shader);
 	DVLB_Free(dvlb);
 
-	linearFree(pool_addr);
-	linearFree(gpu_cmd);
-	vramFree(gpu_fb_addr);
-	vramFree(gpu_depth_fb_addr);
-
 	sf2d_initialized = 0;
 
+	int i;
+	for (i = 0; i < 2; i++) {
+		struct frame_slot *slot = &slots[i];
+		pool = &slot->pool;
+		sf2d_pool_reset(); // Frees the overflow blocks
+		linearFree(slot->pool.addr);
+		linearFree(slot->gpu_cmd);
+		vramFree(slot->fb_addr);
+		vramFree(slot->depth_fb_addr);
+	}
+	pool = &slots[0].pool;
+
 	return 1;
 }
 
@@ -124,8 +210,18 @@ void sf2d_set_3D(int enable)
 
 void sf2d_start_frame(gfxScreen_t screen, gfx3dSide_t side)
 {
+	//Build on the slot the GPU is not rendering, once its target is cleared
+	cur_slot ^= 1;
+	struct frame_slot *slot = &slots[cur_slot];
+	finish_clear(slot);
+	slot->frame = ++frame_count;
+	slot->screen = screen;
+	slot->side = side;
+
+	pool = &slot->pool;
 	sf2d_pool_reset();
-	GPUCMD_SetBufferOffset(0);
+	GPUCMD_SetBuffer(slot->gpu_cmd, gpu_cmd_size, 0);
+	memset(&frame_stats, 0, sizeof(frame_stats));
 
 	// Only upload the uniform if the screen changes
 	if (screen != cur_screen) {
@@ -137,6 +233,8 @@ void sf2d_start_frame(gfxScreen_t screen, gfx3dSide_t side)
 		cur_screen = screen;
 	}
 
+	matrix_identity2x3(transform_user);
+
 	int screen_w;
 	if (screen == GFX_TOP) {
 		screen_w = 400;
@@ -144,8 +242,8 @@ void sf2d_start_frame(gfxScreen_t screen, gfx3dSide_t side)
 	} else {
 		screen_w = 320;
 	}
-	GPU_SetViewport((u32 *)osConvertVirtToPhys(gpu_depth_fb_addr),
-		(u32 *)osConvertVirtToPhys(gpu_fb_addr),
+	GPU_SetViewport((u32 *)osConvertVirtToPhys(slot->depth_fb_addr),
+		(u32 *)osConvertVirtToPhys(slot->fb_addr),
 		0, 0, 240, screen_w);
 
 	GPU_DepthMap(-1.0f, 0.0f);
@@ -177,34 +275,35 @@ void sf2d_end_frame()
 {
 	GPU_FinishDrawing();
 	GPUCMD_Finalize();
-	GPUCMD_FlushAndRun();
-	gspWaitForP3D();
 
-	//Copy the GPU rendered FB to the screen FB
-	if (cur_screen == GFX_TOP) {
-		GX_DisplayTransfer(gpu_fb_addr, GX_BUFFER_DIM(240, 400),
-			(u32 *)gfxGetFramebuffer(GFX_TOP, cur_side, NULL, NULL),
-			GX_BUFFER_DIM(240, 400), 0x1000);
-	} else {
-		GX_DisplayTransfer(gpu_fb_addr, GX_BUFFER_DIM(240, 320),
-			(u32 *)gfxGetFramebuffer(GFX_BOTTOM, GFX_LEFT, NULL, NULL),
-			GX_BUFFER_DIM(240, 320), 0x1000);
-	}
-	gspWaitForPPF();
+	swap_stats.draw_calls     += frame_stats.draw_calls;
+	swap_stats.vertices       += frame_stats.vertices;
+	swap_stats.texture_binds  += frame_stats.texture_binds;
+	swap_stats.texenv_changes += frame_stats.texenv_changes;
 
-	//Clear the screen
-	GX_MemoryFill(
-		gpu_fb_addr, clear_color, &gpu_fb_addr[240*400], GX_FILL_TRIGGER | GX_FILL_32BIT_DEPTH,
-		gpu_depth_fb_addr, 0, &gpu_depth_fb_addr[240*400], GX_FILL_TRIGGER | GX_FILL_32BIT_DEPTH);
-	gspWaitForPSC0();
+	//Let the previous frame go to the screen and queue this one behind it,
+	//the CPU doesn't wait for it to be rendered
+	finish_render(&slots[cur_slot ^ 1]);
+	zone("sf2d flush", 1);
+	GPUCMD_FlushAndRun();
+	zone("sf2d flush", 0);
+	slots[cur_slot].render_pending = 1;
 }
 
 void sf2d_swapbuffers()
 {
+	//Every frame has to be on the screen framebuffers before swapping them
+	sf2d_wait_gpu();
 	gfxSwapBuffersGpu();
 	if (vblank_wait) {
+		zone("sf2d vblank wait", 1);
 		gspWaitForEvent(GSPGPU_EVENT_VBlank0, false);
+		zone("sf2d vblank wait", 0);
 	}
+	//Keep the stats of the frame we just presented
+	swap_stats.pool_bytes = pool_stats.high_water;
+	last_stats = swap_stats;
+	memset(&swap_stats, 0, sizeof(swap_stats));
 	//Calculate FPS
 	frames++;
 	u64 delta_time = osGetTime() - last_time;
@@ -215,6 +314,137 @@ void sf2d_swapbuffers()
 	}
 }
 
+void sf2d_wait_gpu()
+{
+	//Oldest slot first, the GPU finishes them in order
+	finish_transfer(&slots[cur_slot ^ 1]);
+	finish_transfer(&slots[cur_slot]);
+}
+
+static void finish_render(struct frame_slot *slot)
+{
+	if (!slot->render_pending) return;
+	zone("sf2d render wait", 1);
+	gspWaitForP3D();
+	zone("sf2d render wait", 0);
+	slot->render_pending = 0;
+	rendered_frame = slot->frame;
+
+	//Copy the GPU rendered FB to the screen FB
+	if (slot->screen == GFX_TOP) {
+		GX_DisplayTransfer(slot->fb_addr, GX_BUFFER_DIM(240, 400),
+			(u32 *)gfxGetFramebuffer(GFX_TOP, slot->side, NULL, NULL),
+			GX_BUFFER_DIM(240, 400), 0x1000);
+	} else {
+		GX_DisplayTransfer(slot->fb_addr, GX_BUFFER_DIM(240, 320),
+			(u32 *)gfxGetFramebuffer(GFX_BOTTOM, GFX_LEFT, NULL, NULL),
+			GX_BUFFER_DIM(240, 320), 0x1000);
+	}
+	slot->transfer_pending = 1;
+}
+
+static void finish_transfer(struct frame_slot *slot)
+{
+	finish_render(slot);
+	if (!slot->transfer_pending) return;
+	zone("sf2d transfer wait", 1);
+	gspWaitForPPF();
+	zone("sf2d transfer wait", 0);
+	slot->transfer_pending = 0;
+	clear_target(slot);
+}
+
+static void clear_target(struct frame_slot *slot)
+{
+	//PSC0 doesn't count completions, so only one fill may be in flight:
+	//the other slot's fill has to be done before this one starts
+	wait_clear(&slots[(slot - slots) ^ 1]);
+
+	//Only the screen that was drawn needs clearing, the rest of the target is still clear
+	u32 size = (slot->screen == GFX_TOP) ? 240*400 : 240*320;
+	GX_MemoryFill(
+		slot->fb_addr, clear_color, &slot->fb_addr[size], GX_FILL_TRIGGER | GX_FILL_32BIT_DEPTH,
+		slot->depth_fb_addr, 0, &slot->depth_fb_addr[size], GX_FILL_TRIGGER | GX_FILL_32BIT_DEPTH);
+	slot->clear_pending = 1;
+}
+
+static void finish_clear(struct frame_slot *slot)
+{
+	finish_transfer(slot);
+	wait_clear(slot);
+}
+
+static void wait_clear(struct frame_slot *slot)
+{
+	if (!slot->clear_pending) return;
+	zone("sf2d clear wait", 1);
+	gspWaitForPSC0();
+	zone("sf2d clear wait", 0);
+	slot->clear_pending = 0;
+}
+
+void sf2d_set_zone_callback(sf2d_zone_callback callback)
+{
+	zone_callback = callback;
+}
+
+void sf2d_get_stats(sf2d_stats *stats)
+{
+	*stats = last_stats;
+}
+
+void sf2d_stats_draw(u32 vertices)
+{
+	frame_stats.draw_calls++;
+	frame_stats.vertices += vertices;
+}
+
+void sf2d_stats_texture_bind()
+{
+	frame_stats.texture_binds++;
+}
+
+void sf2d_stats_texenv()
+{
+	frame_stats.texenv_changes++;
+}
+
+void sf2d_set_transform(const float *m)
+{
+	if (m) {
+		memcpy(transform_user, m, sizeof(transform_user));
+	} else {
+		matrix_identity2x3(transform_user);
+	}
+}
+
+void sf2d_apply_transform(const float *local)
+{
+	float m[2*3];
+	const float *t = transform_user;
+
+	if (local) {
+		matrix_mult2x3(transform_user, local, m);
+		t = m;
+	}
+
+	// Only upload the uniform if the transform changes
+	if (memcmp(t, transform_gpu, sizeof(transform_gpu)) != 0) {
+		matrix_gpu_set_uniform2x3(t, modelview_desc);
+		memcpy(transform_gpu, t, sizeof(transform_gpu));
+	}
+}
+
+void sf2d_set_vertex_packing(int enable)
+{
+	vertex_packing = enable;
+}
+
+int sf2d_get_vertex_packing()
+{
+	return vertex_packing;
+}
+
 void sf2d_set_vblank_wait(int enable)
 {
 	vblank_wait = enable;
@@ -225,25 +455,73 @@ float sf2d_get_fps()
 	return current_fps;
 }
 
+u32 sf2d_get_frame_count()
+{
+	return frame_count;
+}
+
+u32 sf2d_get_rendered_frame()
+{
+	return rendered_frame;
+}
+
 void *sf2d_pool_malloc(u32 size)
 {
-	if ((pool_index + size) < pool_size) {
-		void *addr = (void *)((u32)pool_addr + pool_index);
-		pool_index += size;
-		return addr;
-	}
-	return NULL;
+	return sf2d_pool_memalign(size, 1);
 }
 
 void *sf2d_pool_memalign(u32 size, u32 alignment)
 {
-	u32 new_index = (pool_index + alignment - 1) & ~(alignment - 1);
-	if ((new_index + size) < pool_size) {
-		void *addr = (void *)((u32)pool_addr + new_index);
-		pool_index = new_index + size;
-		return addr;
+	void *addr = NULL;
+	u32 new_index = (pool->index + alignment - 1) & ~(alignment - 1);
+
+	pool_stats.allocations++;
+
+	if ((new_index + size) < pool->size) {
+		addr = (void *)((u32)pool->addr + new_index);
+		pool->index = new_index + size;
+	} else if (pool_growth) {
+		addr = pool_overflow_memalign(size, alignment);
+	}
+
+	if (!addr) {
+		pool_stats.failures++;
+		return NULL;
+	}
+
+	u32 used = pool->index + pool->overflow_used;
+	if (used > pool_stats.high_water) {
+		pool_stats.high_water = used;
 	}
-	return NULL;
+	return addr;
+}
+
+static void *pool_overflow_memalign(u32 size, u32 alignment)
+{
+	struct pool_block *block = pool->overflow;
+
+	// Start a new block if there's none yet or the current one is full
+	if (!block || ((((u32)block + block->index + alignment - 1) & ~(alignment - 1)) + size) > (u32)block + block->size) {
+		u32 block_size = sizeof(struct pool_block) + size + alignment;
+		if (block_size < SF2D_TEMPPOOL_OVERFLOW_SIZE) {
+			block_size = SF2D_TEMPPOOL_OVERFLOW_SIZE;
+		}
+		block = linearAlloc(block_size);
+		if (!block) return NULL;
+
+		block->next  = pool->overflow;
+		block->size  = block_size;
+		block->index = sizeof(struct pool_block);
+		pool->overflow = block;
+	}
+
+	u32 addr = ((u32)block + block->index + alignment - 1) & ~(alignment - 1);
+	u32 new_index = addr + size - (u32)block;
+	pool->overflow_used += new_index - block->index;
+	block->index = new_index;
+
+	pool_stats.overflows++;
+	return (void *)addr;
 }
 
 void *sf2d_pool_calloc(u32 nmemb, u32 size)
@@ -253,12 +531,50 @@ void *sf2d_pool_calloc(u32 nmemb, u32 size)
 
 unsigned int sf2d_pool_space_free()
 {
-	return pool_size - pool_index;
+	return pool->size - pool->index;
 }
 
 void sf2d_pool_reset()
 {
-	pool_index = 0;
+	if (pool->overflow) {
+		u32 needed = pool->index + pool->overflow_used;
+
+		while (pool->overflow) {
+			struct pool_block *next = pool->overflow->next;
+			linearFree(pool->overflow);
+			pool->overflow = next;
+		}
+		pool->overflow_used = 0;
+
+		// Grow the main pool so the same load fits without overflowing
+		if (pool_growth && sf2d_initialized) {
+			u32 new_size = (needed + SF2D_TEMPPOOL_OVERFLOW_SIZE) & ~(SF2D_TEMPPOOL_OVERFLOW_SIZE - 1);
+			void *new_addr = linearAlloc(new_size);
+			if (new_addr) {
+				linearFree(pool->addr);
+				pool->addr = new_addr;
+				pool->size = new_size;
+			}
+		}
+	}
+	pool->index = 0;
+}
+
+void sf2d_set_pool_growth(int enable)
+{
+	pool_growth = enable;
+}
+
+void sf2d_get_pool_stats(sf2d_pool_stats *stats)
+{
+	*stats = pool_stats;
+	stats->size = pool->size;
+	stats->used = pool->index + pool->overflow_used;
+}
+
+void sf2d_reset_pool_stats()
+{
+	memset(&pool_stats, 0, sizeof(pool_stats));
 }
 
 void sf2d_set_clear_color(u32 color)
@@ -298,7 +614,7 @@ static void apt_hook_func(APT_HookType hook, void *param)
 
 static void reset_gpu_apt_resume()
 {
-	GPU_Reset(NULL, gpu_cmd, gpu_cmd_size); // Only required for custom GPU cmd sizes
+	GPU_Reset(NULL, slots[cur_slot].gpu_cmd, gpu_cmd_size); // Only required for custom GPU cmd sizes
 	shaderProgramUse(&shader);
 
 	if (cur_screen == GFX_TOP) {
@@ -307,6 +623,11 @@ static void reset_gpu_apt_resume()
 		matrix_gpu_set_uniform(ortho_matrix_bot, projection_desc);
 	}
 
+	float modelview[4*4];
+	matrix_identity4x4(modelview);
+	matrix_gpu_set_uniform(modelview, modelview_desc);
+	matrix_gpu_set_uniform2x3(transform_gpu, modelview_desc);
+
 	GPUCMD_Finalize();
 	GPUCMD_FlushAndRun();
 	gspWaitForP3D();
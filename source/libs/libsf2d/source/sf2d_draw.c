@@ -1,6 +1,65 @@
 #include "sf2d.h"
 #include "sf2d_private.h"
 #include <math.h>
+#include <string.h>
+
+int sf2d_draw_quad_packed(float left, float top, float right, float bottom, s16 u0, s16 v0, s16 u1, s16 v1, u32 color, const float *local)
+{
+	//Packing must not move anything, fractional or far away quads keep the float format
+	if (!sf2d_packs_exactly(left) || !sf2d_packs_exactly(top) ||
+		!sf2d_packs_exactly(right) || !sf2d_packs_exactly(bottom)) return 0;
+
+	sf2d_vertex_packed *vertices = sf2d_pool_memalign(4 * sizeof(sf2d_vertex_packed), 8);
+	if (!vertices) return 1;
+
+	s16 x0 = sf2d_pack_position(left);
+	s16 y0 = sf2d_pack_position(top);
+	s16 x1 = sf2d_pack_position(right);
+	s16 y1 = sf2d_pack_position(bottom);
+
+	vertices[0] = (sf2d_vertex_packed){x0, y0, u0, v0, color};
+	vertices[1] = (sf2d_vertex_packed){x1, y0, u1, v0, color};
+	vertices[2] = (sf2d_vertex_packed){x0, y1, u0, v1, color};
+	vertices[3] = (sf2d_vertex_packed){x1, y1, u1, v1, color};
+
+	sf2d_apply_transform(local);
+
+	GPU_SetAttributeBuffers(
+		3, // number of attributes
+		(u32*)osConvertVirtToPhys(vertices),
+		GPU_ATTRIBFMT(0, 2, GPU_SHORT) | GPU_ATTRIBFMT(1, 2, GPU_SHORT) | GPU_ATTRIBFMT(2, 4, GPU_UNSIGNED_BYTE),
+		0xFFF8, //0b1000
+		0x210,
+		1, //number of buffers
+		(u32[]){0x0}, // buffer offsets (placeholders)
+		(u64[]){0x210}, // attribute permutations for each buffer
+		(u8[]){3} // number of attributes for each buffer
+	);
+
+	// Switch the vertex shader to its packed path (bool uniform b0) for this draw only
+	GPUCMD_AddWrite(GPUREG_VSH_BOOLUNIFORM, 0x7FFF0000 | BIT(0));
+	GPU_DrawArray(GPU_TRIANGLE_STRIP, 0, 4);
+	sf2d_stats_draw(4);
+	GPUCMD_AddWrite(GPUREG_VSH_BOOLUNIFORM, 0x7FFF0000);
+	return 1;
+}
+
+void sf2d_apply_transform_packed(const float *local, float origin_x, float origin_y)
+{
+	// Maps positions given in 1/SF2D_PACKED_SUBPIXELS pixels from an origin back to pixels
+	float m[6] = {
+		1.0f/SF2D_PACKED_SUBPIXELS, 0.0f, origin_x,
+		0.0f, 1.0f/SF2D_PACKED_SUBPIXELS, origin_y
+	};
+
+	if (local) {
+		float scale[6];
+		memcpy(scale, m, sizeof(scale));
+		matrix_mult2x3(local, scale, m);
+	}
+
+	sf2d_apply_transform(m);
+}
 
 void sf2d_draw_line(int x0, int y0, int x1, int y1, u32 color)
 {
@@ -17,6 +76,7 @@ void sf2d_draw_line(int x0, int y0, int x1, int y1, u32 color)
 	vertices[2].color = vertices[0].color;
 	vertices[3].color = vertices[0].color;
 
+	sf2d_stats_texenv();
 	GPU_SetTexEnv(
 		0,
 		GPU_TEVSOURCES(GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR),
@@ -27,6 +87,8 @@ void sf2d_draw_line(int x0, int y0, int x1, int y1, u32 color)
 		0xFFFFFFFF
 	);
 
+	sf2d_apply_transform(NULL);
+
 	GPU_SetAttributeBuffers(
 		2, // number of attributes
 		(u32*)osConvertVirtToPhys(vertices),
@@ -40,10 +102,26 @@ void sf2d_draw_line(int x0, int y0, int x1, int y1, u32 color)
 	);
 
 	GPU_DrawArray(GPU_TRIANGLE_STRIP, 0, 4);
+	sf2d_stats_draw(4);
 }
 
 void sf2d_draw_rectangle(int x, int y, int w, int h, u32 color)
 {
+	sf2d_stats_texenv();
+	GPU_SetTexEnv(
+		0,
+		GPU_TEVSOURCES(GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR),
+		GPU_TEVSOURCES(GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR),
+		GPU_TEVOPERANDS(0, 0, 0),
+		GPU_TEVOPERANDS(0, 0, 0),
+		GPU_REPLACE, GPU_REPLACE,
+		0xFFFFFFFF
+	);
+
+	if (sf2d_get_vertex_packing() && sf2d_draw_quad_packed(x, y, x+w, y+h, 0, 0, 0, 0, color, NULL)) {
+		return;
+	}
+
 	sf2d_vertex_pos_col *vertices = sf2d_pool_memalign(4 * sizeof(sf2d_vertex_pos_col), 8);
 	if (!vertices) return;
 
@@ -57,15 +135,7 @@ void sf2d_draw_rectangle(int x, int y, int w, int h, u32 color)
 	vertices[2].color = vertices[0].color;
 	vertices[3].color = vertices[0].color;
 
-	GPU_SetTexEnv(
-		0,
-		GPU_TEVSOURCES(GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR),
-		GPU_TEVSOURCES(GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR),
-		GPU_TEVOPERANDS(0, 0, 0),
-		GPU_TEVOPERANDS(0, 0, 0),
-		GPU_REPLACE, GPU_REPLACE,
-		0xFFFFFFFF
-	);
+	sf2d_apply_transform(NULL);
 
 	GPU_SetAttributeBuffers(
 		2, // number of attributes
@@ -80,6 +150,7 @@ void sf2d_draw_rectangle(int x, int y, int w, int h, u32 color)
 	);
 
 	GPU_DrawArray(GPU_TRIANGLE_STRIP, 0, 4);
+	sf2d_stats_draw(4);
 }
 
 void sf2d_draw_rectangle_rotate(int x, int y, int w, int h, u32 color, float rad)
@@ -100,16 +171,41 @@ void sf2d_draw_rectangle_rotate(int x, int y, int w, int h, u32 color, float rad
 	vertices[2].color = vertices[0].color;
 	vertices[3].color = vertices[0].color;
 
-	float m[4*4];
-	matrix_set_z_rotation(m, rad);
-	sf2d_vector_3f rot[4];
+	sf2d_stats_texenv();
+	GPU_SetTexEnv(
+		0,
+		GPU_TEVSOURCES(GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR),
+		GPU_TEVSOURCES(GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR),
+		GPU_TEVOPERANDS(0, 0, 0),
+		GPU_TEVOPERANDS(0, 0, 0),
+		GPU_REPLACE, GPU_REPLACE,
+		0xFFFFFFFF
+	);
+
+	// Rotate and translate in the vertex shader
+	const float c = cosf(rad);
+	const float s = sinf(rad);
+	sf2d_apply_transform((float[]){c, -s, x + w2, s, c, y + h2});
 
-	int i;
-	for (i = 0; i < 4; i++) {
-		vector_mult_matrix4x4(m, &vertices[i].position, &rot[i]);
-		vertices[i].position = (sf2d_vector_3f){rot[i].x + x + w2, rot[i].y + y + h2, rot[i].z};
-	}
+	GPU_SetAttributeBuffers(
+		2, // number of attributes
+		(u32*)osConvertVirtToPhys(vertices),
+		GPU_ATTRIBFMT(0, 3, GPU_FLOAT) | GPU_ATTRIBFMT(1, 4, GPU_UNSIGNED_BYTE),
+		0xFFFC, //0b1100
+		0x10,
+		1, //number of buffers
+		(u32[]){0x0}, // buffer offsets (placeholders)
+		(u64[]){0x10}, // attribute permutations for each buffer
+		(u8[]){2} // number of attributes for each buffer
+	);
+
+	GPU_DrawArray(GPU_TRIANGLE_STRIP, 0, 4);
+	sf2d_stats_draw(4);
+}
 
+void sf2d_draw_rectangle_transform(float x, float y, float w, float h, const float *m, u32 color)
+{
+	sf2d_stats_texenv();
 	GPU_SetTexEnv(
 		0,
 		GPU_TEVSOURCES(GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR),
@@ -120,6 +216,32 @@ void sf2d_draw_rectangle_rotate(int x, int y, int w, int h, u32 color, float rad
 		0xFFFFFFFF
 	);
 
+	// Plain translations stay on the CPU, anything else goes to the vertex shader
+	if (m && matrix_is_translation2x3(m)) {
+		x += m[2];
+		y += m[5];
+		m = NULL;
+	}
+
+	if (sf2d_get_vertex_packing() && sf2d_draw_quad_packed(x, y, x+w, y+h, 0, 0, 0, 0, color, m)) {
+		return;
+	}
+
+	sf2d_vertex_pos_col *vertices = sf2d_pool_memalign(4 * sizeof(sf2d_vertex_pos_col), 8);
+	if (!vertices) return;
+
+	vertices[0].position = (sf2d_vector_3f){x,   y,   SF2D_DEFAULT_DEPTH};
+	vertices[1].position = (sf2d_vector_3f){x+w, y,   SF2D_DEFAULT_DEPTH};
+	vertices[2].position = (sf2d_vector_3f){x,   y+h, SF2D_DEFAULT_DEPTH};
+	vertices[3].position = (sf2d_vector_3f){x+w, y+h, SF2D_DEFAULT_DEPTH};
+
+	vertices[0].color = color;
+	vertices[1].color = vertices[0].color;
+	vertices[2].color = vertices[0].color;
+	vertices[3].color = vertices[0].color;
+
+	sf2d_apply_transform(m);
+
 	GPU_SetAttributeBuffers(
 		2, // number of attributes
 		(u32*)osConvertVirtToPhys(vertices),
@@ -133,6 +255,7 @@ void sf2d_draw_rectangle_rotate(int x, int y, int w, int h, u32 color, float rad
 	);
 
 	GPU_DrawArray(GPU_TRIANGLE_STRIP, 0, 4);
+	sf2d_stats_draw(4);
 }
 
 void sf2d_draw_fill_circle(int x, int y, int radius, u32 color)
@@ -165,6 +288,7 @@ void sf2d_draw_fill_circle(int x, int y, int radius, u32 color)
 	vertices[num_segments + 1].position = vertices[1].position;
 	vertices[num_segments + 1].color = vertices[1].color;
 
+	sf2d_stats_texenv();
 	GPU_SetTexEnv(
 		0,
 		GPU_TEVSOURCES(GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR),
@@ -175,6 +299,8 @@ void sf2d_draw_fill_circle(int x, int y, int radius, u32 color)
 		0xFFFFFFFF
 	);
 
+	sf2d_apply_transform(NULL);
+
 	GPU_SetAttributeBuffers(
 		2, // number of attributes
 		(u32*)osConvertVirtToPhys(vertices),
@@ -188,4 +314,129 @@ void sf2d_draw_fill_circle(int x, int y, int radius, u32 color)
 	);
 
 	GPU_DrawArray(GPU_TRIANGLE_FAN, 0, num_segments + 2);
+	sf2d_stats_draw(num_segments + 2);
+}
+
+void sf2d_draw_vertices(const float *positions, int count, GPU_Primitive_t primitive, u32 color)
+{
+	if (count <= 0) return;
+
+	sf2d_vertex_pos_col *vertices = sf2d_pool_memalign(count * sizeof(sf2d_vertex_pos_col), 8);
+	if (!vertices) return;
+
+	for (int i = 0; i < count; i++) {
+		vertices[i].position = (sf2d_vector_3f){positions[i*2], positions[i*2+1], SF2D_DEFAULT_DEPTH};
+		vertices[i].color = color;
+	}
+
+	sf2d_stats_texenv();
+	GPU_SetTexEnv(
+		0,
+		GPU_TEVSOURCES(GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR),
+		GPU_TEVSOURCES(GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR),
+		GPU_TEVOPERANDS(0, 0, 0),
+		GPU_TEVOPERANDS(0, 0, 0),
+		GPU_REPLACE, GPU_REPLACE,
+		0xFFFFFFFF
+	);
+
+	sf2d_apply_transform(NULL);
+
+	GPU_SetAttributeBuffers(
+		2, // number of attributes
+		(u32*)osConvertVirtToPhys(vertices),
+		GPU_ATTRIBFMT(0, 3, GPU_FLOAT) | GPU_ATTRIBFMT(1, 4, GPU_UNSIGNED_BYTE),
+		0xFFFC, //0b1100
+		0x10,
+		1, //number of buffers
+		(u32[]){0x0}, // buffer offsets (placeholders)
+		(u64[]){0x10}, // attribute permutations for each buffer
+		(u8[]){2} // number of attributes for each buffer
+	);
+
+	GPU_DrawArray(primitive, 0, count);
+	sf2d_stats_draw(count);
+}
+
+void sf2d_draw_vertices_packed(const sf2d_texture *texture, const sf2d_vertex_packed *vertices, const u16 *indices, int first, int count, GPU_Primitive_t primitive, const float *m, u32 color)
+{
+	if (count <= 0) return;
+
+	sf2d_stats_texenv();
+
+	if (texture) {
+		// texture * vertex color, then * color in the second stage
+		GPU_SetTexEnv(
+			0,
+			GPU_TEVSOURCES(GPU_TEXTURE0, GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR),
+			GPU_TEVSOURCES(GPU_TEXTURE0, GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR),
+			GPU_TEVOPERANDS(0, 0, 0),
+			GPU_TEVOPERANDS(0, 0, 0),
+			GPU_MODULATE, GPU_MODULATE,
+			0xFFFFFFFF
+		);
+		GPU_SetTexEnv(
+			1,
+			GPU_TEVSOURCES(GPU_PREVIOUS, GPU_CONSTANT, GPU_CONSTANT),
+			GPU_TEVSOURCES(GPU_PREVIOUS, GPU_CONSTANT, GPU_CONSTANT),
+			GPU_TEVOPERANDS(0, 0, 0),
+			GPU_TEVOPERANDS(0, 0, 0),
+			GPU_MODULATE, GPU_MODULATE,
+			color
+		);
+
+		GPU_SetTextureEnable(GPU_TEXUNIT0);
+
+		sf2d_stats_texture_bind();
+		GPU_SetTexture(
+			GPU_TEXUNIT0,
+			(u32 *)osConvertVirtToPhys(texture->data),
+			texture->pow2_w,
+			texture->pow2_h,
+			texture->params,
+			texture->pixel_format
+		);
+	} else {
+		GPU_SetTexEnv(
+			0,
+			GPU_TEVSOURCES(GPU_PRIMARY_COLOR, GPU_CONSTANT, GPU_CONSTANT),
+			GPU_TEVSOURCES(GPU_PRIMARY_COLOR, GPU_CONSTANT, GPU_CONSTANT),
+			GPU_TEVOPERANDS(0, 0, 0),
+			GPU_TEVOPERANDS(0, 0, 0),
+			GPU_MODULATE, GPU_MODULATE,
+			color
+		);
+	}
+
+	sf2d_apply_transform(m);
+
+	u32 base = (u32)osConvertVirtToPhys(vertices);
+
+	GPU_SetAttributeBuffers(
+		3, // number of attributes
+		(u32*)base,
+		GPU_ATTRIBFMT(0, 2, GPU_SHORT) | GPU_ATTRIBFMT(1, 2, GPU_SHORT) | GPU_ATTRIBFMT(2, 4, GPU_UNSIGNED_BYTE),
+		0xFFF8, //0b1000
+		0x210,
+		1, //number of buffers
+		(u32[]){0x0}, // buffer offsets (placeholders)
+		(u64[]){0x210}, // attribute permutations for each buffer
+		(u8[]){3} // number of attributes for each buffer
+	);
+
+	// Switch the vertex shader to its packed path (bool uniform b0) for this draw only
+	GPUCMD_AddWrite(GPUREG_VSH_BOOLUNIFORM, 0x7FFF0000 | BIT(0));
+
+	if (indices) {
+		// The index buffer address is an offset from the vertex buffer
+		u32 offset = (u32)osConvertVirtToPhys(indices + first) - base;
+		GPU_DrawElements(primitive, (u32*)offset, count);
+	} else {
+		GPU_DrawArray(primitive, first, count);
+	}
+
+	sf2d_stats_draw(count);
+	GPUCMD_AddWrite(GPUREG_VSH_BOOLUNIFORM, 0x7FFF0000);
+
+	if (texture) GPU_SetDummyTexEnv(1);
 }
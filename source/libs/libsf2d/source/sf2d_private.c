@@ -133,6 +133,33 @@ void matrix_init_orthographic(float *m, float left, float right, float bottom, f
 	matrix_swap_xy(m);
 }
 
+void matrix_identity2x3(float *m)
+{
+	m[0] = m[4] = 1.0f;
+	m[1] = m[2] = 0.0f;
+	m[3] = m[5] = 0.0f;
+}
+
+void matrix_mult2x3(const float *src1, const float *src2, float *dst)
+{
+	dst[0] = src1[0]*src2[0] + src1[1]*src2[3];
+	dst[1] = src1[0]*src2[1] + src1[1]*src2[4];
+	dst[2] = src1[0]*src2[2] + src1[1]*src2[5] + src1[2];
+	dst[3] = src1[3]*src2[0] + src1[4]*src2[3];
+	dst[4] = src1[3]*src2[1] + src1[4]*src2[4];
+	dst[5] = src1[3]*src2[2] + src1[4]*src2[5] + src1[5];
+}
+
+void matrix_gpu_set_uniform2x3(const float *m, u32 startreg)
+{
+	// Only the first two rows of the 4x4 matrix depend on the 2D transform
+	float rows[2*4] = {
+		m[0], m[1], 0.0f, m[2],
+		m[3], m[4], 0.0f, m[5]
+	};
+	GPU_SetFloatUniform(GPU_VERTEX_SHADER, startreg, (u32 *)rows, 2);
+}
+
 //Grabbed from: http://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2
 unsigned int next_pow2(unsigned int v)
 {
@@ -96,6 +96,7 @@ sf2d_texture *sf2d_create_texture(int width, int height, sf2d_texfmt pixel_forma
 void sf2d_free_texture(sf2d_texture *texture)
 {
 	if (texture) {
+		sf2d_wait_gpu(); // It may be in a frame that is still rendering
 		if (texture->place == SF2D_PLACE_RAM) {
 			linearFree(texture->data);
 		} else if (texture->place == SF2D_PLACE_VRAM) {
@@ -134,6 +135,7 @@ void sf2d_bind_texture(const sf2d_texture *texture, GPU_TEXUNIT unit)
 {
 	GPU_SetTextureEnable(unit);
 
+	sf2d_stats_texenv();
 	GPU_SetTexEnv(
 		0,
 		GPU_TEVSOURCES(GPU_TEXTURE0, GPU_TEXTURE0, GPU_TEXTURE0),
@@ -144,6 +146,7 @@ void sf2d_bind_texture(const sf2d_texture *texture, GPU_TEXUNIT unit)
 		0xFFFFFFFF
 	);
 
+	sf2d_stats_texture_bind();
 	GPU_SetTexture(
 		unit,
 		(u32 *)osConvertVirtToPhys(texture->data),
@@ -158,6 +161,7 @@ void sf2d_bind_texture_color(const sf2d_texture *texture, GPU_TEXUNIT unit, u32
 {
 	GPU_SetTextureEnable(unit);
 
+	sf2d_stats_texenv();
 	GPU_SetTexEnv(
 		0,
 		GPU_TEVSOURCES(GPU_TEXTURE0, GPU_CONSTANT, GPU_CONSTANT),
@@ -168,6 +172,7 @@ void sf2d_bind_texture_color(const sf2d_texture *texture, GPU_TEXUNIT unit, u32
 		color
 	);
 
+	sf2d_stats_texture_bind();
 	GPU_SetTexture(
 		unit,
 		(u32 *)osConvertVirtToPhys(texture->data),
@@ -182,6 +187,7 @@ void sf2d_bind_texture_parameters(const sf2d_texture *texture, GPU_TEXUNIT unit,
 {
 	GPU_SetTextureEnable(unit);
 
+	sf2d_stats_texenv();
 	GPU_SetTexEnv(
 		0,
 		GPU_TEVSOURCES(GPU_TEXTURE0, GPU_TEXTURE0, GPU_TEXTURE0),
@@ -192,6 +198,7 @@ void sf2d_bind_texture_parameters(const sf2d_texture *texture, GPU_TEXUNIT unit,
 		0xFFFFFFFF
 	);
 
+	sf2d_stats_texture_bind();
 	GPU_SetTexture(
 		unit,
 		(u32 *)osConvertVirtToPhys(texture->data),
@@ -214,6 +221,14 @@ int sf2d_texture_get_params(const sf2d_texture *texture)
 
 static inline void sf2d_draw_texture_generic(const sf2d_texture *texture, int x, int y)
 {
+	if (sf2d_get_vertex_packing() && sf2d_draw_quad_packed(x, y, x+texture->width, y+texture->height,
+			0, 0,
+			sf2d_pack_texcoord(texture->width, texture->pow2_w),
+			sf2d_pack_texcoord(texture->height, texture->pow2_h),
+			0xFFFFFFFF, NULL)) {
+		return;
+	}
+
 	sf2d_vertex_pos_tex *vertices = sf2d_pool_memalign(4 * sizeof(sf2d_vertex_pos_tex), 8);
 	if (!vertices) return;
 
@@ -233,6 +248,8 @@ static inline void sf2d_draw_texture_generic(const sf2d_texture *texture, int x,
 	vertices[2].texcoord = (sf2d_vector_2f){0.0f, v};
 	vertices[3].texcoord = (sf2d_vector_2f){u,    v};
 
+	sf2d_apply_transform(NULL);
+
 	GPU_SetAttributeBuffers(
 		2, // number of attributes
 		(u32*)osConvertVirtToPhys(vertices),
@@ -246,6 +263,7 @@ static inline void sf2d_draw_texture_generic(const sf2d_texture *texture, int x,
 	);
 
 	GPU_DrawArray(GPU_TRIANGLE_STRIP, 0, 4);
+	sf2d_stats_draw(4);
 }
 
 void sf2d_draw_texture(const sf2d_texture *texture, int x, int y)
@@ -292,15 +310,10 @@ static inline void sf2d_draw_texture_rotate_hotspot_generic(const sf2d_texture *
 	vertices[2].texcoord = (sf2d_vector_2f){0.0f, v};
 	vertices[3].texcoord = (sf2d_vector_2f){u,    v};
 
+	// Rotate and translate in the vertex shader
 	const float c = cosf(rad);
 	const float s = sinf(rad);
-	int i;
-	for (i = 0; i < 4; ++i) { // Rotate and translate
-		float _x = vertices[i].position.x;
-		float _y = vertices[i].position.y;
-		vertices[i].position.x = _x*c - _y*s + x;
-		vertices[i].position.y = _x*s + _y*c + y;
-	}
+	sf2d_apply_transform((float[]){c, -s, x, s, c, y});
 
 	GPU_SetAttributeBuffers(
 		2, // number of attributes
@@ -315,6 +328,7 @@ static inline void sf2d_draw_texture_rotate_hotspot_generic(const sf2d_texture *
 	);
 
 	GPU_DrawArray(GPU_TRIANGLE_STRIP, 0, 4);
+	sf2d_stats_draw(4);
 }
 
 void sf2d_draw_texture_rotate_hotspot(const sf2d_texture *texture, int x, int y, float rad, float center_x, float center_y)
@@ -346,6 +360,15 @@ void sf2d_draw_texture_rotate_blend(const sf2d_texture *texture, int x, int y, f
 
 static inline void sf2d_draw_texture_part_generic(const sf2d_texture *texture, int x, int y, int tex_x, int tex_y, int tex_w, int tex_h)
 {
+	if (sf2d_get_vertex_packing() && sf2d_draw_quad_packed(x, y, x+tex_w, y+tex_h,
+			sf2d_pack_texcoord(tex_x, texture->pow2_w),
+			sf2d_pack_texcoord(tex_y, texture->pow2_h),
+			sf2d_pack_texcoord(tex_x+tex_w, texture->pow2_w),
+			sf2d_pack_texcoord(tex_y+tex_h, texture->pow2_h),
+			0xFFFFFFFF, NULL)) {
+		return;
+	}
+
 	sf2d_vertex_pos_tex *vertices = sf2d_pool_memalign(4 * sizeof(sf2d_vertex_pos_tex), 8);
 	if (!vertices) return;
 
@@ -364,6 +387,8 @@ static inline void sf2d_draw_texture_part_generic(const sf2d_texture *texture, i
 	vertices[2].texcoord = (sf2d_vector_2f){u0, v1};
 	vertices[3].texcoord = (sf2d_vector_2f){u1, v1};
 
+	sf2d_apply_transform(NULL);
+
 	GPU_SetAttributeBuffers(
 		2, // number of attributes
 		(u32*)osConvertVirtToPhys(vertices),
@@ -377,6 +402,7 @@ static inline void sf2d_draw_texture_part_generic(const sf2d_texture *texture, i
 	);
 
 	GPU_DrawArray(GPU_TRIANGLE_STRIP, 0, 4);
+	sf2d_stats_draw(4);
 }
 
 void sf2d_draw_texture_part(const sf2d_texture *texture, int x, int y, int tex_x, int tex_y, int tex_w, int tex_h)
@@ -393,6 +419,14 @@ void sf2d_draw_texture_part_blend(const sf2d_texture *texture, int x, int y, int
 
 static inline void sf2d_draw_texture_scale_generic(const sf2d_texture *texture, int x, int y, float x_scale, float y_scale)
 {
+	if (sf2d_get_vertex_packing() && sf2d_draw_quad_packed(x, y, x+texture->width*x_scale, y+texture->height*y_scale,
+			0, 0,
+			sf2d_pack_texcoord(texture->width, texture->pow2_w),
+			sf2d_pack_texcoord(texture->height, texture->pow2_h),
+			0xFFFFFFFF, NULL)) {
+		return;
+	}
+
 	sf2d_vertex_pos_tex *vertices = sf2d_pool_memalign(4 * sizeof(sf2d_vertex_pos_tex), 8);
 	if (!vertices) return;
 
@@ -412,6 +446,8 @@ static inline void sf2d_draw_texture_scale_generic(const sf2d_texture *texture,
 	vertices[2].texcoord = (sf2d_vector_2f){0.0f, v};
 	vertices[3].texcoord = (sf2d_vector_2f){u,    v};
 
+	sf2d_apply_transform(NULL);
+
 	GPU_SetAttributeBuffers(
 		2, // number of attributes
 		(u32*)osConvertVirtToPhys(vertices),
@@ -425,6 +461,7 @@ static inline void sf2d_draw_texture_scale_generic(const sf2d_texture *texture,
 	);
 
 	GPU_DrawArray(GPU_TRIANGLE_STRIP, 0, 4);
+	sf2d_stats_draw(4);
 }
 
 void sf2d_draw_texture_scale(const sf2d_texture *texture, int x, int y, float x_scale, float y_scale)
@@ -441,6 +478,15 @@ void sf2d_draw_texture_scale_blend(const sf2d_texture *texture, int x, int y, fl
 
 static inline void sf2d_draw_texture_part_scale_generic(const sf2d_texture *texture, float x, float y, float tex_x, float tex_y, float tex_w, float tex_h, float x_scale, float y_scale)
 {
+	if (sf2d_get_vertex_packing() && sf2d_draw_quad_packed(x, y, x+tex_w*x_scale, y+tex_h*y_scale,
+			sf2d_pack_texcoord(tex_x, texture->pow2_w),
+			sf2d_pack_texcoord(tex_y, texture->pow2_h),
+			sf2d_pack_texcoord(tex_x+tex_w, texture->pow2_w),
+			sf2d_pack_texcoord(tex_y+tex_h, texture->pow2_h),
+			0xFFFFFFFF, NULL)) {
+		return;
+	}
+
 	sf2d_vertex_pos_tex *vertices = sf2d_pool_memalign(4 * sizeof(sf2d_vertex_pos_tex), 8);
 	if (!vertices) return;
 
@@ -462,6 +508,8 @@ static inline void sf2d_draw_texture_part_scale_generic(const sf2d_texture *text
 	vertices[2].position = (sf2d_vector_3f){(float)x,       (float)y+tex_h, SF2D_DEFAULT_DEPTH};
 	vertices[3].position = (sf2d_vector_3f){(float)x+tex_w, (float)y+tex_h, SF2D_DEFAULT_DEPTH};
 
+	sf2d_apply_transform(NULL);
+
 	GPU_SetAttributeBuffers(
 		2, // number of attributes
 		(u32*)osConvertVirtToPhys(vertices),
@@ -475,6 +523,7 @@ static inline void sf2d_draw_texture_part_scale_generic(const sf2d_texture *text
 	);
 
 	GPU_DrawArray(GPU_TRIANGLE_STRIP, 0, 4);
+	sf2d_stats_draw(4);
 }
 
 void sf2d_draw_texture_part_scale(const sf2d_texture *texture, float x, float y, float tex_x, float tex_y, float tex_w, float tex_h, float x_scale, float y_scale)
@@ -512,15 +561,10 @@ static inline void sf2d_draw_texture_part_rotate_scale_generic(const sf2d_textur
 	vertices[2].texcoord = (sf2d_vector_2f){u0, v1};
 	vertices[3].texcoord = (sf2d_vector_2f){u1, v1};
 
+	// Rotate and translate in the vertex shader
 	const float c = cosf(rad);
 	const float s = sinf(rad);
-	int i;
-	for (i = 0; i < 4; ++i) { // Rotate and translate
-		float _x = vertices[i].position.x;
-		float _y = vertices[i].position.y;
-		vertices[i].position.x = _x*c - _y*s + x;
-		vertices[i].position.y = _x*s + _y*c + y;
-	}
+	sf2d_apply_transform((float[]){c, -s, x, s, c, y});
 
 	GPU_SetAttributeBuffers(
 		2, // number of attributes
@@ -535,6 +579,7 @@ static inline void sf2d_draw_texture_part_rotate_scale_generic(const sf2d_textur
 	);
 
 	GPU_DrawArray(GPU_TRIANGLE_STRIP, 0, 4);
+	sf2d_stats_draw(4);
 }
 
 void sf2d_draw_texture_part_rotate_scale(const sf2d_texture *texture, int x, int y, float rad, int tex_x, int tex_y, int tex_w, int tex_h, float x_scale, float y_scale)
@@ -549,6 +594,252 @@ void sf2d_draw_texture_part_rotate_scale_blend(const sf2d_texture *texture, int
 	sf2d_draw_texture_part_rotate_scale_generic(texture, x, y, rad, tex_x, tex_y, tex_w, tex_h, x_scale, y_scale);
 }
 
+static inline void sf2d_draw_texture_part_transform_generic(const sf2d_texture *texture, float x, float y, int tex_x, int tex_y, int tex_w, int tex_h, const float *m)
+{
+	// Plain translations stay on the CPU, anything else goes to the vertex shader
+	if (m && matrix_is_translation2x3(m)) {
+		x += m[2];
+		y += m[5];
+		m = NULL;
+	}
+
+	if (sf2d_get_vertex_packing() && sf2d_draw_quad_packed(x, y, x+tex_w, y+tex_h,
+			sf2d_pack_texcoord(tex_x, texture->pow2_w),
+			sf2d_pack_texcoord(tex_y, texture->pow2_h),
+			sf2d_pack_texcoord(tex_x+tex_w, texture->pow2_w),
+			sf2d_pack_texcoord(tex_y+tex_h, texture->pow2_h),
+			0xFFFFFFFF, m)) {
+		return;
+	}
+
+	sf2d_vertex_pos_tex *vertices = sf2d_pool_memalign(4 * sizeof(sf2d_vertex_pos_tex), 8);
+	if (!vertices) return;
+
+	vertices[0].position = (sf2d_vector_3f){x,       y,       SF2D_DEFAULT_DEPTH};
+	vertices[1].position = (sf2d_vector_3f){x+tex_w, y,       SF2D_DEFAULT_DEPTH};
+	vertices[2].position = (sf2d_vector_3f){x,       y+tex_h, SF2D_DEFAULT_DEPTH};
+	vertices[3].position = (sf2d_vector_3f){x+tex_w, y+tex_h, SF2D_DEFAULT_DEPTH};
+
+	float u0 = tex_x/(float)texture->pow2_w;
+	float v0 = tex_y/(float)texture->pow2_h;
+	float u1 = (tex_x+tex_w)/(float)texture->pow2_w;
+	float v1 = (tex_y+tex_h)/(float)texture->pow2_h;
+
+	vertices[0].texcoord = (sf2d_vector_2f){u0, v0};
+	vertices[1].texcoord = (sf2d_vector_2f){u1, v0};
+	vertices[2].texcoord = (sf2d_vector_2f){u0, v1};
+	vertices[3].texcoord = (sf2d_vector_2f){u1, v1};
+
+	sf2d_apply_transform(m);
+
+	GPU_SetAttributeBuffers(
+		2, // number of attributes
+		(u32*)osConvertVirtToPhys(vertices),
+		GPU_ATTRIBFMT(0, 3, GPU_FLOAT) | GPU_ATTRIBFMT(1, 2, GPU_FLOAT),
+		0xFFFC, //0b1100
+		0x10,
+		1, //number of buffers
+		(u32[]){0x0}, // buffer offsets (placeholders)
+		(u64[]){0x10}, // attribute permutations for each buffer
+		(u8[]){2} // number of attributes for each buffer
+	);
+
+	GPU_DrawArray(GPU_TRIANGLE_STRIP, 0, 4);
+	sf2d_stats_draw(4);
+}
+
+void sf2d_draw_texture_part_transform(const sf2d_texture *texture, float x, float y, int tex_x, int tex_y, int tex_w, int tex_h, const float *m)
+{
+	sf2d_bind_texture(texture, GPU_TEXUNIT0);
+	sf2d_draw_texture_part_transform_generic(texture, x, y, tex_x, tex_y, tex_w, tex_h, m);
+}
+
+void sf2d_draw_texture_part_transform_blend(const sf2d_texture *texture, float x, float y, int tex_x, int tex_y, int tex_w, int tex_h, const float *m, u32 color)
+{
+	sf2d_bind_texture_color(texture, GPU_TEXUNIT0, color);
+	sf2d_draw_texture_part_transform_generic(texture, x, y, tex_x, tex_y, tex_w, tex_h, m);
+}
+
+static inline void sf2d_sprite_corners(const sf2d_sprite *sp, float origin_x, float origin_y, float scale, sf2d_vector_2f *corners)
+{
+	float c = 1.0f, s = 0.0f;
+	if (sp->rad != 0.0f) {
+		c = cosf(sp->rad);
+		s = sinf(sp->rad);
+	}
+
+	// Corners relative to the origin, then rotated, scaled and moved to x, y,
+	// given relative to origin_x, origin_y
+	float l = -sp->ox, t = -sp->oy;
+	float r = l + sp->tex_w, b = t + sp->tex_h;
+
+	float ax = c * sp->sx, bx = -s * sp->sy;
+	float ay = s * sp->sx, by = c * sp->sy;
+	float x = sp->x - origin_x, y = sp->y - origin_y;
+
+	corners[0] = (sf2d_vector_2f){(x + ax*l + bx*t) * scale, (y + ay*l + by*t) * scale};
+	corners[1] = (sf2d_vector_2f){(x + ax*r + bx*t) * scale, (y + ay*r + by*t) * scale};
+	corners[2] = (sf2d_vector_2f){(x + ax*l + bx*b) * scale, (y + ay*l + by*b) * scale};
+	corners[3] = (sf2d_vector_2f){(x + ax*r + bx*b) * scale, (y + ay*r + by*b) * scale};
+}
+
+static inline int sf2d_sprite_fits_packed(const sf2d_vector_2f *corners)
+{
+	int i;
+	for (i = 0; i < 4; i++) {
+		if (fabsf(corners[i].u) > 32767.0f || fabsf(corners[i].v) > 32767.0f) return 0;
+	}
+	return 1;
+}
+
+void sf2d_draw_texture_sprites_blend(const sf2d_texture *texture, const sf2d_sprite *sprites, int count, u32 color)
+{
+	if (count <= 0) return;
+
+	sf2d_bind_texture_color(texture, GPU_TEXUNIT0, color);
+	sf2d_apply_transform(NULL);
+
+	float pw = texture->pow2_w;
+	float ph = texture->pow2_h;
+
+	while (count > 0) {
+		int n = count < SF2D_SPRITES_PER_DRAW ? count : SF2D_SPRITES_PER_DRAW;
+
+		// Separate triangles, so the sprites don't need degenerate strip joins
+		sf2d_vertex_pos_tex *vertices = sf2d_pool_memalign(n * 6 * sizeof(sf2d_vertex_pos_tex), 8);
+		if (!vertices) return;
+
+		sf2d_vertex_pos_tex *v = vertices;
+
+		for (int i = 0; i < n; i++) {
+			const sf2d_sprite *sp = &sprites[i];
+
+			sf2d_vector_2f p[4];
+			sf2d_sprite_corners(sp, 0.0f, 0.0f, 1.0f, p);
+
+			float u0 = sp->tex_x/pw;
+			float v0 = sp->tex_y/ph;
+			float u1 = (sp->tex_x+sp->tex_w)/pw;
+			float v1 = (sp->tex_y+sp->tex_h)/ph;
+
+			v[0] = (sf2d_vertex_pos_tex){{p[0].u, p[0].v, SF2D_DEFAULT_DEPTH}, {u0, v0}};
+			v[1] = (sf2d_vertex_pos_tex){{p[1].u, p[1].v, SF2D_DEFAULT_DEPTH}, {u1, v0}};
+			v[2] = (sf2d_vertex_pos_tex){{p[2].u, p[2].v, SF2D_DEFAULT_DEPTH}, {u0, v1}};
+			v[3] = v[2];
+			v[4] = v[1];
+			v[5] = (sf2d_vertex_pos_tex){{p[3].u, p[3].v, SF2D_DEFAULT_DEPTH}, {u1, v1}};
+			v += 6;
+		}
+
+		GPU_SetAttributeBuffers(
+			2, // number of attributes
+			(u32*)osConvertVirtToPhys(vertices),
+			GPU_ATTRIBFMT(0, 3, GPU_FLOAT) | GPU_ATTRIBFMT(1, 2, GPU_FLOAT),
+			0xFFFC, //0b1100
+			0x10,
+			1, //number of buffers
+			(u32[]){0x0}, // buffer offsets (placeholders)
+			(u64[]){0x10}, // attribute permutations for each buffer
+			(u8[]){2} // number of attributes for each buffer
+		);
+
+		GPU_DrawArray(GPU_TRIANGLES, 0, n * 6);
+		sf2d_stats_draw(n * 6);
+
+		sprites += n;
+		count -= n;
+	}
+}
+
+void sf2d_draw_texture_sprites_color(const sf2d_texture *texture, const sf2d_sprite *sprites, const u32 *colors, int count, const float *m)
+{
+	if (count <= 0) return;
+
+	GPU_SetTextureEnable(GPU_TEXUNIT0);
+
+	// texture * vertex color
+	sf2d_stats_texenv();
+	GPU_SetTexEnv(
+		0,
+		GPU_TEVSOURCES(GPU_TEXTURE0, GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR),
+		GPU_TEVSOURCES(GPU_TEXTURE0, GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR),
+		GPU_TEVOPERANDS(0, 0, 0),
+		GPU_TEVOPERANDS(0, 0, 0),
+		GPU_MODULATE, GPU_MODULATE,
+		0xFFFFFFFF
+	);
+
+	sf2d_stats_texture_bind();
+	GPU_SetTexture(
+		GPU_TEXUNIT0,
+		(u32 *)osConvertVirtToPhys(texture->data),
+		texture->pow2_w,
+		texture->pow2_h,
+		texture->params,
+		texture->pixel_format
+	);
+
+	while (count > 0) {
+		int n = count < SF2D_SPRITES_PER_DRAW ? count : SF2D_SPRITES_PER_DRAW;
+
+		sf2d_vertex_packed *vertices = sf2d_pool_memalign(n * 6 * sizeof(sf2d_vertex_packed), 8);
+		if (!vertices) return;
+
+		sf2d_vertex_packed *v = vertices;
+
+		// Packed positions are sub-pixels from the batch's first sprite, whose position
+		// goes into the transform. A sprite out of s16 range from it starts the next batch.
+		float origin_x = floorf(sprites[0].x);
+		float origin_y = floorf(sprites[0].y);
+		sf2d_apply_transform_packed(m, origin_x, origin_y);
+
+		int i;
+		for (i = 0; i < n; i++) {
+			const sf2d_sprite *sp = &sprites[i];
+			u32 color = colors[i];
+
+			sf2d_vector_2f p[4];
+			sf2d_sprite_corners(sp, origin_x, origin_y, SF2D_PACKED_SUBPIXELS, p);
+			if (i > 0 && !sf2d_sprite_fits_packed(p)) break;
+
+			s16 u0 = sf2d_pack_texcoord(sp->tex_x, texture->pow2_w);
+			s16 v0 = sf2d_pack_texcoord(sp->tex_y, texture->pow2_h);
+			s16 u1 = sf2d_pack_texcoord(sp->tex_x+sp->tex_w, texture->pow2_w);
+			s16 v1 = sf2d_pack_texcoord(sp->tex_y+sp->tex_h, texture->pow2_h);
+
+			v[0] = (sf2d_vertex_packed){sf2d_pack_position(p[0].u), sf2d_pack_position(p[0].v), u0, v0, color};
+			v[1] = (sf2d_vertex_packed){sf2d_pack_position(p[1].u), sf2d_pack_position(p[1].v), u1, v0, color};
+			v[2] = (sf2d_vertex_packed){sf2d_pack_position(p[2].u), sf2d_pack_position(p[2].v), u0, v1, color};
+			v[3] = v[2];
+			v[4] = v[1];
+			v[5] = (sf2d_vertex_packed){sf2d_pack_position(p[3].u), sf2d_pack_position(p[3].v), u1, v1, color};
+			v += 6;
+		}
+
+		GPU_SetAttributeBuffers(
+			3, // number of attributes
+			(u32*)osConvertVirtToPhys(vertices),
+			GPU_ATTRIBFMT(0, 2, GPU_SHORT) | GPU_ATTRIBFMT(1, 2, GPU_SHORT) | GPU_ATTRIBFMT(2, 4, GPU_UNSIGNED_BYTE),
+			0xFFF8, //0b1000
+			0x210,
+			1, //number of buffers
+			(u32[]){0x0}, // buffer offsets (placeholders)
+			(u64[]){0x210}, // attribute permutations for each buffer
+			(u8[]){3} // number of attributes for each buffer
+		);
+
+		// Switch the vertex shader to its packed path (bool uniform b0) for this draw only
+		GPUCMD_AddWrite(GPUREG_VSH_BOOLUNIFORM, 0x7FFF0000 | BIT(0));
+		GPU_DrawArray(GPU_TRIANGLES, 0, i * 6);
+		sf2d_stats_draw(i * 6);
+		GPUCMD_AddWrite(GPUREG_VSH_BOOLUNIFORM, 0x7FFF0000);
+
+		sprites += i;
+		colors += i;
+		count -= i;
+	}
+}
+
 static inline void sf2d_draw_texture_depth_generic(const sf2d_texture *texture, int x, int y, signed short z)
 {
 	sf2d_vertex_pos_tex *vertices = sf2d_pool_memalign(4 * sizeof(sf2d_vertex_pos_tex), 8);
@@ -571,6 +862,8 @@ static inline void sf2d_draw_texture_depth_generic(const sf2d_texture *texture,
 	vertices[2].texcoord = (sf2d_vector_2f){0.0f, v};
 	vertices[3].texcoord = (sf2d_vector_2f){u,    v};
 
+	sf2d_apply_transform(NULL);
+
 	GPU_SetAttributeBuffers(
 		2, // number of attributes
 		(u32*)osConvertVirtToPhys(vertices),
@@ -584,6 +877,7 @@ static inline void sf2d_draw_texture_depth_generic(const sf2d_texture *texture,
 	);
 
 	GPU_DrawArray(GPU_TRIANGLE_STRIP, 0, 4);
+	sf2d_stats_draw(4);
 }
 
 void sf2d_draw_texture_depth(const sf2d_texture *texture, int x, int y, signed short z)
@@ -616,6 +910,8 @@ void sf2d_draw_quad_uv(const sf2d_texture *texture, float left, float top, float
 
 	sf2d_bind_texture_parameters(texture, GPU_TEXUNIT0, params);
 
+	sf2d_apply_transform(NULL);
+
 	GPU_SetAttributeBuffers(
 		2, // number of attributes
 		(u32*)osConvertVirtToPhys(vertices),
@@ -629,6 +925,7 @@ void sf2d_draw_quad_uv(const sf2d_texture *texture, float left, float top, float
 	);
 
 	GPU_DrawArray(GPU_TRIANGLE_STRIP, 0, 4);
+	sf2d_stats_draw(4);
 }
 
 // Grabbed from Citra Emulator (citra/src/video_core/utils.h)
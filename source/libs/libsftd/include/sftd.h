@@ -22,6 +22,14 @@ extern "C" {
  */
 typedef struct sftd_font sftd_font;
 
+/**
+ * @brief Text drawing statistics, accumulated since the last sftd_reset_stats call
+ */
+typedef struct {
+	unsigned int glyphs;        /**< Number of glyphs drawn */
+	unsigned int atlas_misses;  /**< Number of glyphs that had to be rendered into an atlas */
+} sftd_stats;
+
 // Basic functions
 
 /**
@@ -57,6 +65,17 @@ sftd_font *sftd_load_font_mem(const void *buffer, unsigned int size);
  */
 void sftd_free_font(sftd_font *font);
 
+/**
+ * @brief Returns the text drawing statistics
+ * @param stats where to store the statistics
+ */
+void sftd_get_stats(sftd_stats *stats);
+
+/**
+ * @brief Resets the text drawing statistics
+ */
+void sftd_reset_stats();
+
 // Draw functions
 
 /**
@@ -13,6 +13,7 @@
 
 static int sftd_initialized = 0;
 static FT_Library ftlibrary;
+static sftd_stats stats;
 
 typedef enum {
 	SFTD_LOAD_FROM_FILE,
@@ -171,10 +172,22 @@ void sftd_free_font(sftd_font *font)
 	}
 }
 
+void sftd_get_stats(sftd_stats *s)
+{
+	*s = stats;
+}
+
+void sftd_reset_stats()
+{
+	memset(&stats, 0, sizeof(stats));
+}
+
 static int atlas_add_glyph(texture_atlas *atlas, unsigned int glyph_index, const FT_BitmapGlyph bitmap_glyph, int glyph_size)
 {
 	const FT_Bitmap *bitmap = &bitmap_glyph->bitmap;
 
+	stats.atlas_misses++;
+
 	unsigned int *buffer = malloc(bitmap->width * bitmap->rows * 4);
 	unsigned int w = bitmap->width;
 	unsigned int h = bitmap->rows;
@@ -261,6 +274,7 @@ void sftd_draw_text(sftd_font *font, int x, int y, unsigned int color, unsigned
 			draw_scale,
 			draw_scale,
 			color);
+		stats.glyphs++;
 
 		pen_x += (advance_x >> 16) * draw_scale;
 		pen_y += (advance_y >> 16) * draw_scale;
@@ -338,6 +352,7 @@ void sftd_draw_wtext(sftd_font *font, int x, int y, unsigned int color, unsigned
 			draw_scale,
 			draw_scale,
 			color);
+		stats.glyphs++;
 
 		pen_x += (advance_x >> 16) * draw_scale;
 		pen_y += (advance_y >> 16) * draw_scale;
@@ -497,6 +512,7 @@ void sftd_draw_text_wrap(sftd_font *font, int x, int y, unsigned int color, unsi
 				draw_scale,
 				draw_scale,
 				color);
+			stats.glyphs++;
 
 			pen_x += (advance_x >> 16) * draw_scale;
 			pen_y += (advance_y >> 16) * draw_scale;
@@ -78,7 +78,8 @@ static UBits barg(lua_State *L, int idx)
   else
     b = (UBits)(SBits)bn.n;
 #elif defined(LUA_NUMBER_FLOAT)
-#error "A 'float' lua_Number type is incompatible with this library"
+  /* Only exact up to 2^24, wraps modulo 2^32 like the double version */
+  b = (UBits)(int64_t)bn.n;
 #else
 #error "Unknown number type, check LUA_NUMBER_* in luaconf.h"
 #endif
@@ -163,9 +164,14 @@ static const struct luaL_Reg bit_funcs[] = {
 LUALIB_API int luaopen_bit(lua_State *L)
 {
   UBits b;
-  lua_pushnumber(L, (lua_Number)1437217655L);
+#ifdef LUA_NUMBER_FLOAT
+#define BIT_SELFTEST	1437204480L  /* 0x55aa0000, exact in a float */
+#else
+#define BIT_SELFTEST	1437217655L
+#endif
+  lua_pushnumber(L, (lua_Number)BIT_SELFTEST);
   b = barg(L, -1);
-  if (b != (UBits)1437217655L || BAD_SAR) {  /* Perform a simple self-test. */
+  if (b != (UBits)BIT_SELFTEST || BAD_SAR) {  /* Perform a simple self-test. */
     const char *msg = "compiled with incompatible luaconf.h";
 #ifdef LUA_NUMBER_DOUBLE
 #ifdef _WIN32
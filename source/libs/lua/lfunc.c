@@ -134,6 +134,7 @@ Proto *luaF_newproto (lua_State *L) {
   f->linedefined = 0;
   f->lastlinedefined = 0;
   f->source = NULL;
+  f->icache = NULL;
   return f;
 }
 
@@ -145,10 +146,24 @@ void luaF_freeproto (lua_State *L, Proto *f) {
   luaM_freearray(L, f->lineinfo, f->sizelineinfo, int);
   luaM_freearray(L, f->locvars, f->sizelocvars, struct LocVar);
   luaM_freearray(L, f->upvalues, f->sizeupvalues, TString *);
+  if (f->icache)
+    luaM_freearray(L, f->icache, f->sizecode, Node *);
   luaM_free(L, f);
 }
 
 
+/*
+** the inline cache is only allocated for functions that run, when the
+** code is final
+*/
+void luaF_initcache (lua_State *L, Proto *f) {
+  int i;
+  f->icache = luaM_newvector(L, f->sizecode, Node *);
+  for (i = 0; i < f->sizecode; i++)
+    f->icache[i] = NULL;
+}
+
+
 void luaF_freeclosure (lua_State *L, Closure *c) {
   int size = (c->c.isC) ? sizeCclosure(c->c.nupvalues) :
                           sizeLclosure(c->l.nupvalues);
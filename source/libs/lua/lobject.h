@@ -237,6 +237,7 @@ typedef struct Proto {
   struct LocVar *locvars;  /* information about local variables */
   TString **upvalues;  /* upvalue names */
   TString  *source;
+  struct Node **icache;  /* per-instruction lookup cache, `sizecode' entries */
   int sizeupvalues;
   int sizek;  /* size of `k' */
   int sizecode;
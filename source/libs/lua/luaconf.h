@@ -474,6 +474,17 @@
 */
 #define LUAL_BUFFERSIZE		BUFSIZ
 
+
+/*
+@@ LUA_USE_COMPUTED_GOTO makes luaV_execute jump straight from one
+@* instruction to the next through a table of label addresses (a GCC
+@* extension) instead of going back to a switch.
+** CHANGE it (define LUA_NO_COMPUTED_GOTO) to use the plain switch.
+*/
+#if defined(__GNUC__) && !defined(LUA_NO_COMPUTED_GOTO)
+#define LUA_USE_COMPUTED_GOTO
+#endif
+
 /* }================================================================== */
 
 
@@ -488,8 +499,18 @@
 ** ===================================================================
 */
 
+/*
+@@ LUA_NUMBER_FLOAT selects single-precision numbers when defined at
+@* build time. The ARM11 VFP divides and converts floats much faster
+@* than doubles, but integers above 2^24 (like os.time()) lose
+@* precision and double-precision bytecode no longer loads.
+*/
+#if defined(LUA_NUMBER_FLOAT)
+#define LUA_NUMBER	float
+#else
 #define LUA_NUMBER_DOUBLE
 #define LUA_NUMBER	double
+#endif
 
 /*
 @@ LUAI_UACNUMBER is the result of an 'usual argument conversion'
@@ -505,11 +526,17 @@
 @@ LUAI_MAXNUMBER2STR is maximum size of previous conversion.
 @@ lua_str2number converts a string to a number.
 */
+#if defined(LUA_NUMBER_FLOAT)
+#define LUA_NUMBER_SCAN		"%f"
+#define LUA_NUMBER_FMT		"%.7g"
+#define lua_str2number(s,p)	strtof((s), (p))
+#else
 #define LUA_NUMBER_SCAN		"%lf"
 #define LUA_NUMBER_FMT		"%.14g"
+#define lua_str2number(s,p)	strtod((s), (p))
+#endif
 #define lua_number2str(s,n)	sprintf((s), LUA_NUMBER_FMT, (n))
 #define LUAI_MAXNUMBER2STR	32 /* 16 digits, sign, point, and \0 */
-#define lua_str2number(s,p)	strtod((s), (p))
 
 
 /*
@@ -521,8 +548,13 @@
 #define luai_numsub(a,b)	((a)-(b))
 #define luai_nummul(a,b)	((a)*(b))
 #define luai_numdiv(a,b)	((a)/(b))
+#if defined(LUA_NUMBER_FLOAT)
+#define luai_nummod(a,b)	((a) - floorf((a)/(b))*(b))
+#define luai_numpow(a,b)	(powf(a,b))
+#else
 #define luai_nummod(a,b)	((a) - floor((a)/(b))*(b))
 #define luai_numpow(a,b)	(pow(a,b))
+#endif
 #define luai_numunm(a)		(-(a))
 #define luai_numeq(a,b)		((a)==(b))
 #define luai_numlt(a,b)		((a)<(b))
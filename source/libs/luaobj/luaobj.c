@@ -89,3 +89,14 @@ void *luaobj_checkudata(lua_State *L, int index, uint32_t type) {
   }
   return udata + 1;
 }
+
+
+void *luaobj_testudata(lua_State *L, int index, uint32_t type) {
+  /* Like luaobj_checkudata, but returns NULL instead of erroring out if the
+   * value isn't a udata of the given class */
+  luaobj_head_t *udata = lua_touserdata(L, index);
+  if (!udata || !(udata->type & type)) {
+    return NULL;
+  }
+  return udata + 1;
+}
@@ -25,12 +25,16 @@ typedef struct {
 #define LUAOBJ_TYPE_FONT   (1 << 1)
 #define LUAOBJ_TYPE_SOURCE (1 << 2)
 #define LUAOBJ_TYPE_QUAD   (1 << 3)
+#define LUAOBJ_TYPE_SOUNDDATA (1 << 4)
+#define LUAOBJ_TYPE_PARTICLESYSTEM (1 << 5)
+#define LUAOBJ_TYPE_MESH   (1 << 6)
 
 int luaobj_newclass(lua_State *L, const char *name, const char *extends, 
                     int (*constructor)(lua_State*), luaL_Reg* reg);
 void luaobj_setclass(lua_State *L, uint32_t type, char *name);
 void *luaobj_newudata(lua_State *L, int size);
 void *luaobj_checkudata(lua_State *L, int index, uint32_t type);
+void *luaobj_testudata(lua_State *L, int index, uint32_t type);
 
 
 #endif
\ No newline at end of file
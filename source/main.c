@@ -22,6 +22,8 @@
 
 #include "shared.h"
 #include "util.h"
+#include "trace.h"
+#include "bytecode.h"
 
 char *rootDir = "";
 
@@ -30,6 +32,14 @@ lua_State *L;
 int initLove(lua_State *L);
 void finiLove();
 
+void resetTransformStack();
+bool screenNeedsDraw(gfxScreen_t screen);
+void sourceUpdateStreams();
+
+int timerFixedSteps();
+double timerFixedAlpha();
+double timerFixedStep();
+
 bool errorOccured = false;
 bool forceQuit = false;
 const char *errMsg;
@@ -42,6 +52,33 @@ void displayError() {
 
 }
 
+// Calls love[name](...) with nargs numbers, if it's defined
+int loveCall(const char *name, int nargs, double arg) {
+
+	lua_getfield(L, LUA_GLOBALSINDEX, "love");
+	lua_getfield(L, -1, name);
+	lua_remove(L, -2);
+
+	if (lua_isnil(L, -1)) {
+		lua_pop(L, 1);
+		return 0;
+	}
+
+	if (nargs > 0) lua_pushnumber(L, arg);
+
+	return lua_pcall(L, nargs, 0, 0);
+
+}
+
+void loveDraw() {
+
+	// With a fixed timestep love.draw gets the interpolation alpha
+	int nargs = timerFixedStep() > 0;
+
+	if (loveCall("draw", nargs, timerFixedAlpha())) displayError();
+
+}
+
 int main() {
 
 	L = luaL_newstate();
@@ -49,6 +86,7 @@ int main() {
 	luaL_requiref(L, "love", initLove, 1);
 
 	sf2d_init(); // 2D Drawing lib.
+	sf2d_set_zone_callback(traceZone); // GPU waits show up in love.timer traces
 	sftd_init(); // Text Drawing lib.
 	cfguInit();
 	ptmuInit();
@@ -56,6 +94,7 @@ int main() {
 	// consoleInit(GFX_BOTTOM, NULL);
 
 	sf2d_set_clear_color(RGBA8(0x0, 0x0, 0x0, 0xFF)); // Reset background color.
+	sf2d_set_vertex_packing(1); // 12-byte vertices for plain quads on whole pixels.
 
 	osSetSpeedupEnable(true); // Enables CPU speedup (I think?)
 
@@ -75,6 +114,8 @@ int main() {
 	luaU_dostring(L, "package.path = './?.lua;./?/init.lua'"); // Set default requiring path.
 	luaU_dostring(L, "package.cpath = './?.lua;./?/init.lua'");
 
+	bytecodeInstallLoader(L); // Modules are loaded from the bytecode cache when it's up to date
+
 	luaU_dostring(L, 
 		"function love.errhand(msg)\n"
 			"love.audio.stop()"
@@ -88,7 +129,7 @@ int main() {
 		"end"
 	); // default love.errhand()
 
-	if (luaL_dofile(L, "main.lua")) displayError();
+	if (bytecodeLoadFile(L, "main.lua") || lua_pcall(L, 0, LUA_MULTRET, 0)) displayError();
 
 	if (luaU_dostring(L, "if love.load then love.load() end")) displayError();
 
@@ -120,43 +161,96 @@ int main() {
 
 		if (!errorOccured) {
 
+			traceBegin("input");
+
 			if (luaU_dostring(L,
 				"love.keyboard.scan()\n"
-				"love.timer.step()\n"
-				"if love.update then love.update(love.timer.getDelta()) end")) {
+				"love.timer.step()")) {
 					displayError();
 			}
 
+			traceEnd("input");
+
+			int steps = timerFixedSteps();
+
+			traceBegin("love.update");
+
+			if (steps == -1) {
+				if (!errorOccured && luaU_dostring(L, "if love.update then love.update(love.timer.getDelta()) end")) displayError();
+			} else {
+				for (int i = 0; i < steps && !errorOccured; i++) {
+					if (loveCall("update", 1, timerFixedStep())) displayError();
+				}
+			}
+
+			traceEnd("love.update");
+
+			if (soundEnabled) {
+				traceBegin("audio streams");
+				sourceUpdateStreams();
+				traceEnd("audio streams");
+			}
+
+			sf2d_reset_pool_stats(); // Pool usage is reported per frame
+
 			// Top screen
 			// Left side
 
-			sf2d_start_frame(GFX_TOP, GFX_LEFT);
+			if (screenNeedsDraw(GFX_TOP)) {
 
-				if (luaU_dostring(L, "if love.draw then love.draw() end")) displayError();
+				traceBegin("draw top left");
 
-			sf2d_end_frame();
+				sf2d_start_frame(GFX_TOP, GFX_LEFT);
 
-			// Right side
+					resetTransformStack();
 
-			if (is3D) {
+					loveDraw();
 
-				sf2d_start_frame(GFX_TOP, GFX_RIGHT);
+				sf2d_end_frame();
 
-					if (luaU_dostring(L, "if love.draw then love.draw() end")) displayError();
+				traceEnd("draw top left");
 
-				sf2d_end_frame();
+				// Right side
+
+				if (is3D) {
+
+					traceBegin("draw top right");
+
+					sf2d_start_frame(GFX_TOP, GFX_RIGHT);
+
+						resetTransformStack();
+
+						loveDraw();
+
+					sf2d_end_frame();
+
+					traceEnd("draw top right");
+
+				}
 
 			}
 
 			// Bot screen
 
-			sf2d_start_frame(GFX_BOTTOM, GFX_LEFT);
+			if (screenNeedsDraw(GFX_BOTTOM)) {
 
-				if (luaU_dostring(L, "if love.draw then love.draw() end")) displayError();
+				traceBegin("draw bottom");
 
-			sf2d_end_frame();
+				sf2d_start_frame(GFX_BOTTOM, GFX_LEFT);
+
+					resetTransformStack();
+
+					loveDraw();
+
+				sf2d_end_frame();
+
+				traceEnd("draw bottom");
+
+			}
 
+			traceBegin("present");
 			luaU_dostring(L, "love.graphics.present()");
+			traceEnd("present");
 
 		} else {
 
@@ -171,6 +265,8 @@ int main() {
 
 			sf2d_start_frame(GFX_TOP, GFX_LEFT);
 
+				resetTransformStack();
+
 				lua_getfield(L, LUA_GLOBALSINDEX, "love");
 				lua_getfield(L, -1, "errhand");
 				lua_remove(L, -2);
@@ -186,6 +282,8 @@ int main() {
 
 			sf2d_start_frame(GFX_BOTTOM, GFX_LEFT);
 
+				resetTransformStack();
+
 				lua_getfield(L, LUA_GLOBALSINDEX, "love");
 				lua_getfield(L, -1, "errhand");
 				lua_remove(L, -2);
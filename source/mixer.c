@@ -0,0 +1,303 @@
+// This code is licensed under the MIT Open Source License.
+
+// Copyright (c) 2015 Ruairidh Carmichael - ruairidhcarmichael@live.co.uk
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Software mixing bus: many short PCM16 sounds mixed into one stereo
+// ndsp channel, so they don't each need a hardware voice.
+
+#include "shared.h"
+#include "util.h"
+
+#if defined(__ARM_FEATURE_SAT) || defined(__ARM_FEATURE_SIMD32)
+	#include <arm_acle.h>
+#endif
+
+#if defined(__ARM_FEATURE_SAT)
+	#define MIXER_SAT16(x) __ssat((x), 16)
+#else
+	#define MIXER_SAT16(x) ((x) > 32767 ? 32767 : ((x) < -32768 ? -32768 : (x)))
+#endif
+
+// Frames are mixed as packed left/right pairs, the low half is left
+#define MIXER_PACK(l, r) (((u32)(l) & 0xFFFF) | ((u32)(r) << 16))
+
+#if defined(__ARM_FEATURE_SIMD32)
+	#define MIXER_QADD16(a, b) ((u32)__qadd16((a), (b)))
+#else
+	#define MIXER_QADD16(a, b) MIXER_PACK(MIXER_SAT16((s16)(a) + (s16)(b)), MIXER_SAT16((s16)((a) >> 16) + (s16)((b) >> 16)))
+#endif
+
+#define MIXER_CHANNEL 23
+#define MIXER_VOICES 32
+#define MIXER_RATE 32728 // ndsp output rate, so the channel needs no resampling
+#define MIXER_FRAMES 512 // Stereo frames per block
+#define MIXER_BLOCKS 3
+#define MIXER_GAIN_MAX 16.0f // Keeps scaled samples within 32 bits
+
+struct MixerVoice {
+
+	love_sample *sample; // Retained, released on the main thread when the slot is reused
+	u32 generation;
+	bool active;
+	bool loop;
+
+	u32 pos; // Integer frame position
+	u32 frac; // 16.16 fractional position and step, for sources not at MIXER_RATE
+	u32 step;
+
+	s32 gainL, gainR; // Q15
+
+};
+
+struct MixerVoice mixerVoices[MIXER_VOICES];
+
+bool mixerRunning = false;
+LightLock mixerLock;
+s16 *mixerBuffer;
+ndspWaveBuf mixerWaveBufs[MIXER_BLOCKS];
+u32 mixerAccum[MIXER_FRAMES]; // Packed stereo frames
+
+extern int voiceCount;
+void voiceRelease(int channel);
+
+void sampleRetain(love_sample *self);
+void sampleRelease(love_sample *self);
+
+static void mixerVoiceRender(struct MixerVoice *voice, u32 *accum, int frames) {
+
+	const s16 *data = (const s16 *)voice->sample->data;
+	u32 nsamples = voice->sample->nsamples;
+	u32 stride = voice->sample->channels;
+	s32 gainL = voice->gainL, gainR = voice->gainR;
+
+	for (int i = 0; i < frames; i++) {
+
+		if (voice->pos >= nsamples) {
+			if (!voice->loop) {
+				voice->active = false;
+				return;
+			}
+			voice->pos %= nsamples;
+		}
+
+		const s16 *frame = &data[voice->pos * stride];
+
+		s32 l = ((s64)frame[0] * gainL) >> 15;
+		s32 r = ((s64)frame[stride - 1] * gainR) >> 15;
+
+		// One saturating add mixes both channels
+		accum[i] = MIXER_QADD16(accum[i], MIXER_PACK(MIXER_SAT16(l), MIXER_SAT16(r)));
+
+		voice->frac += voice->step;
+		voice->pos += voice->frac >> 16;
+		voice->frac &= 0xFFFF;
+
+	}
+
+}
+
+void mixerRender(s16 *out, int frames) {
+
+	memset(mixerAccum, 0, frames * sizeof(u32));
+
+	// Every add saturates, so loud overlaps clip instead of wrapping
+	for (int i = 0; i < MIXER_VOICES; i++) {
+		if (mixerVoices[i].active) mixerVoiceRender(&mixerVoices[i], mixerAccum, frames);
+	}
+
+	// Packed frames are already interleaved left/right samples
+	memcpy(out, mixerAccum, frames * sizeof(u32));
+
+}
+
+static void mixerCallback(void *data) {
+
+	LightLock_Lock(&mixerLock);
+
+	for (int i = 0; i < MIXER_BLOCKS; i++) {
+
+		ndspWaveBuf *waveBuf = &mixerWaveBufs[i];
+
+		if (waveBuf->status == NDSP_WBUF_DONE) {
+			mixerRender(waveBuf->data_pcm16, MIXER_FRAMES);
+			DSP_FlushDataCache((u32*)waveBuf->data_pcm16, MIXER_FRAMES * 2 * sizeof(s16));
+			ndspChnWaveBufAdd(MIXER_CHANNEL, waveBuf);
+		}
+
+	}
+
+	LightLock_Unlock(&mixerLock);
+
+}
+
+bool mixerStart() {
+
+	if (mixerRunning) return true;
+	if (!soundEnabled) return false;
+
+	mixerBuffer = linearAlloc(MIXER_BLOCKS * MIXER_FRAMES * 2 * sizeof(s16));
+	if (!mixerBuffer) return false;
+
+	LightLock_Init(&mixerLock);
+
+	// Keep the bus channel out of the hardware voice pool
+	voiceRelease(MIXER_CHANNEL);
+	voiceCount = MIXER_CHANNEL;
+
+	float mix[12] = { 1.0f, 1.0f };
+
+	ndspChnReset(MIXER_CHANNEL);
+	ndspChnInitParams(MIXER_CHANNEL);
+	ndspChnSetMix(MIXER_CHANNEL, mix);
+	ndspChnSetInterp(MIXER_CHANNEL, NDSP_INTERP_NONE);
+	ndspChnSetRate(MIXER_CHANNEL, MIXER_RATE);
+	ndspChnSetFormat(MIXER_CHANNEL, NDSP_FORMAT_STEREO_PCM16);
+
+	memset(mixerBuffer, 0, MIXER_BLOCKS * MIXER_FRAMES * 2 * sizeof(s16));
+	DSP_FlushDataCache((u32*)mixerBuffer, MIXER_BLOCKS * MIXER_FRAMES * 2 * sizeof(s16));
+
+	for (int i = 0; i < MIXER_BLOCKS; i++) {
+		memset(&mixerWaveBufs[i], 0, sizeof(ndspWaveBuf));
+		mixerWaveBufs[i].data_pcm16 = &mixerBuffer[i * MIXER_FRAMES * 2];
+		mixerWaveBufs[i].nsamples = MIXER_FRAMES;
+		ndspChnWaveBufAdd(MIXER_CHANNEL, &mixerWaveBufs[i]);
+	}
+
+	ndspSetCallback(mixerCallback, NULL);
+
+	mixerRunning = true;
+
+	return true;
+
+}
+
+// Q15, clamped so loud volumes can't overflow the mix
+static s32 mixerGain(float gain) {
+
+	if (gain > MIXER_GAIN_MAX) gain = MIXER_GAIN_MAX;
+	if (gain < -MIXER_GAIN_MAX) gain = -MIXER_GAIN_MAX;
+
+	return gain * 32768;
+
+}
+
+int mixerPlay(love_sample *sample, float gainL, float gainR, bool loop, u32 *generation) {
+
+	// An empty sample would leave a looping voice with nothing to wrap around
+	if (sample->encoding != NDSP_ENCODING_PCM16 || sample->nsamples == 0 || !mixerStart()) return -1;
+
+	LightLock_Lock(&mixerLock);
+
+	int slot = -1;
+	for (int i = 0; i < MIXER_VOICES; i++) {
+		if (!mixerVoices[i].active) {
+			slot = i;
+			break;
+		}
+	}
+
+	if (slot != -1) {
+
+		struct MixerVoice *voice = &mixerVoices[slot];
+
+		if (voice->sample) sampleRelease(voice->sample);
+		sampleRetain(sample);
+
+		voice->sample = sample;
+		voice->generation++;
+		voice->loop = loop;
+		voice->pos = 0;
+		voice->frac = 0;
+		voice->step = (u32)(sample->rate * 65536.0f / MIXER_RATE);
+		voice->gainL = mixerGain(gainL);
+		voice->gainR = mixerGain(gainR);
+		voice->active = true;
+
+		*generation = voice->generation;
+
+	}
+
+	LightLock_Unlock(&mixerLock);
+
+	return slot;
+
+}
+
+bool mixerIsPlaying(int slot, u32 generation) {
+
+	return slot != -1 && mixerVoices[slot].generation == generation && mixerVoices[slot].active;
+
+}
+
+void mixerStop(int slot, u32 generation) {
+
+	if (!mixerIsPlaying(slot, generation)) return;
+
+	LightLock_Lock(&mixerLock);
+	mixerVoices[slot].active = false;
+	LightLock_Unlock(&mixerLock);
+
+}
+
+void mixerSetGain(int slot, u32 generation, float gainL, float gainR) {
+
+	if (!mixerIsPlaying(slot, generation)) return;
+
+	LightLock_Lock(&mixerLock);
+	mixerVoices[slot].gainL = mixerGain(gainL);
+	mixerVoices[slot].gainR = mixerGain(gainR);
+	LightLock_Unlock(&mixerLock);
+
+}
+
+u32 mixerTell(int slot, u32 generation) {
+
+	return mixerIsPlaying(slot, generation) ? mixerVoices[slot].pos : 0;
+
+}
+
+void mixerStopAll() {
+
+	if (!mixerRunning) return;
+
+	LightLock_Lock(&mixerLock);
+
+	for (int i = 0; i < MIXER_VOICES; i++) {
+		mixerVoices[i].active = false;
+		if (mixerVoices[i].sample) sampleRelease(mixerVoices[i].sample);
+		mixerVoices[i].sample = NULL;
+	}
+
+	LightLock_Unlock(&mixerLock);
+
+}
+
+int mixerActiveCount() {
+
+	int count = 0;
+
+	for (int i = 0; i < MIXER_VOICES; i++) {
+		if (mixerVoices[i].active) count++;
+	}
+
+	return count;
+
+}
@@ -25,13 +25,21 @@
 
 bool soundEnabled;
 
+void voiceStopAll();
+int voiceActiveCount();
+
+void mixerStopAll();
+int mixerActiveCount();
+
+extern u32 voiceSteals;
+extern u32 voiceRejections;
+
 static int audioStop(lua_State *L) { // love.audio.stop()
 
 	if (!soundEnabled) luaU_error(L, "Could not initialize audio");
 
-	for (int i = 0; i <= 23; i++) {
-		ndspChnWaveBufClear(i);
-	}
+	voiceStopAll();
+	mixerStopAll();
 
 	return 0;
 
@@ -52,6 +60,38 @@ static int audioSetVolume(lua_State *L) { // love.audio.setVolume()
 	
 }
 
+static int audioGetActiveSourceCount(lua_State *L) { // love.audio.getActiveSourceCount()
+
+	lua_pushinteger(L, voiceActiveCount() + mixerActiveCount());
+
+	return 1;
+
+}
+
+static int audioGetStats(lua_State *L) { // love.audio.getStats()
+
+	if (lua_istable(L, 1)) {
+		lua_settop(L, 1);
+	} else {
+		lua_createtable(L, 0, 4);
+	}
+
+	lua_pushinteger(L, voiceActiveCount());
+	lua_setfield(L, -2, "voices");
+
+	lua_pushinteger(L, mixerActiveCount());
+	lua_setfield(L, -2, "mixed");
+
+	lua_pushinteger(L, voiceSteals);
+	lua_setfield(L, -2, "steals");
+
+	lua_pushinteger(L, voiceRejections);
+	lua_setfield(L, -2, "rejections");
+
+	return 1;
+
+}
+
 int sourceNew(lua_State *L);
 
 int initLoveAudio(lua_State *L) {
@@ -61,6 +101,8 @@ int initLoveAudio(lua_State *L) {
 	luaL_Reg reg[] = {
 		{ "stop",		audioStop	},
 		{ "newSource",	sourceNew	},
+		{ "getActiveSourceCount",	audioGetActiveSourceCount	},
+		{ "getStats",	audioGetStats	},
 		{ 0, 0 },
 	};
 
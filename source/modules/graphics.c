@@ -22,6 +22,7 @@
 
 #include "../shared.h"
 #include "../util.h"
+#include "../shape.h"
 
 struct Color {
 
@@ -47,16 +48,11 @@ typedef enum BlendAlphaMode {
 
 } BlendAlphaMode;
 
-struct Coord {
-
-	double x, y;
-
-};
+#define TRANSFORM_STACK_DEPTH 64
 
 struct Transform {
 
-	struct Coord translation, shear;
-	double rotation;
+	float m[6]; // 2x3 affine matrix, row-major: { a, b, tx, c, d, ty }
 
 };
 
@@ -67,20 +63,31 @@ struct GraphicsState {
 	BlendMode blendMode;
 	BlendAlphaMode blendAlphaMode;
 
-	struct Transform transform;
-
 } currentState;
 
+struct Transform transformStack[TRANSFORM_STACK_DEPTH];
+int transformDepth = 0;
+
 int currentScreen = GFX_BOTTOM;
 
-love_font *currentFont;
+// Static screens are drawn once and then kept on display, indexed by gfxScreen_t
+bool screenStatic[2] = { false, false };
+bool screenDrawn[2] = { false, false };
 
-bool isPushed = false;
+love_font *currentFont;
 
 bool is3D = false;
 
+sftd_stats textStats; // Text stats of the last presented frame
+
+int culled = 0; // Primitives dropped off screen since the last present
+int culledStats = 0; // Of the last presented frame
+
 int currentDepth = 0;
 
+float lineWidth = 1; // Width of lines and "line" mode shapes, in pixels before the transform
+ShapeJoin lineJoin = SHAPE_JOIN_MITER;
+
 u32 defaultFilter = GPU_TEXTURE_MAG_FILTER(GPU_LINEAR)|GPU_TEXTURE_MIN_FILTER(GPU_LINEAR); // Default Image Filter.
 const char *defaultMinFilter = "linear";
 const char *defaultMagFilter = "linear";
@@ -91,16 +98,50 @@ u32 getCurrentColor() {
  
 }
 
-int translateCoords(int *x, int *y) {
+static void transformIdentity(float *m) {
 
-	// Emulates the functionality of lg.translate
+	m[0] = 1; m[1] = 0; m[2] = 0;
+	m[3] = 0; m[4] = 1; m[5] = 0;
 
-	if (isPushed) {
+}
 
-		*x += currentState.transform.translation.x;
-		*y += currentState.transform.translation.y;
+static void transformMultiply(float *m, const float *n) { // m = m * n
 
-	}
+	float a = m[0], b = m[1], c = m[3], d = m[4];
+
+	m[0] = a * n[0] + b * n[3];
+	m[1] = a * n[1] + b * n[4];
+	m[2] = a * n[2] + b * n[5] + m[2];
+	m[3] = c * n[0] + d * n[3];
+	m[4] = c * n[1] + d * n[4];
+	m[5] = c * n[2] + d * n[5] + m[5];
+
+}
+
+void resetTransformStack() {
+
+	// Called before every love.draw pass, like love.graphics.origin() in LOVE's love.run
+
+	transformDepth = 0;
+	transformIdentity(transformStack[0].m);
+
+}
+
+bool screenNeedsDraw(gfxScreen_t screen) {
+
+	return !screenStatic[screen] || !screenDrawn[screen];
+
+}
+
+static void screenInvalidate(gfxScreen_t screen) {
+
+	// Draw into the back buffer again, present() stops swapping it once it's shown
+	screenDrawn[screen] = false;
+	gfxSetDoubleBuffering(screen, true);
+
+}
+
+float getStereoOffset() {
 
 	// Sets depth of objects
 
@@ -108,8 +149,8 @@ int translateCoords(int *x, int *y) {
 
 		float slider = CONFIG_3D_SLIDERSTATE;
 
-		if (sf2d_get_current_side() == GFX_LEFT) *x -= (slider * currentDepth);
-		if (sf2d_get_current_side() == GFX_RIGHT) *x += (slider * currentDepth);
+		if (sf2d_get_current_side() == GFX_LEFT) return -(slider * currentDepth);
+		if (sf2d_get_current_side() == GFX_RIGHT) return slider * currentDepth;
 
 	}
 
@@ -117,6 +158,85 @@ int translateCoords(int *x, int *y) {
 
 }
 
+void applyTransform() {
+
+	// Hands the current transform to sf2d, which uploads it to the vertex shader when it changes
+
+	float m[6];
+
+	memcpy(m, transformStack[transformDepth].m, sizeof(m));
+	m[2] += getStereoOffset();
+
+	sf2d_set_transform(m);
+
+}
+
+static void cullMatrix(const float *local, float *m) {
+
+	// Screen space matrix of what's drawn next, as applyTransform leaves it
+
+	memcpy(m, transformStack[transformDepth].m, 6 * sizeof(float));
+	if (local) transformMultiply(m, local);
+	m[2] += getStereoOffset();
+
+}
+
+static bool cullBox(const float *m, float left, float top, float right, float bottom) {
+
+	// true when the box, through m, is entirely off the current screen. Nothing is
+	// tessellated or pushed to sf2d's pool for it, and it's counted in getStats.
+
+	float hw = (right - left) / 2, hh = (bottom - top) / 2;
+	float mx = left + hw, my = top + hh;
+
+	float cx = m[0] * mx + m[1] * my + m[2];
+	float cy = m[3] * mx + m[4] * my + m[5];
+	float ex = fabsf(m[0] * hw) + fabsf(m[1] * hh);
+	float ey = fabsf(m[3] * hw) + fabsf(m[4] * hh);
+
+	float width = sf2d_get_current_screen() == GFX_TOP ? 400 : 320;
+
+	if (cx + ex < 0 || cx - ex > width || cy + ey < 0 || cy - ey > 240) {
+		culled++;
+		return true;
+	}
+
+	return false;
+
+}
+
+static bool cullRect(const float *local, float left, float top, float right, float bottom) {
+
+	float m[6];
+	cullMatrix(local, m);
+
+	return cullBox(m, left, top, right, bottom);
+
+}
+
+static bool cullPoints(const float *points, int count, float pad) {
+
+	float left = points[0], top = points[1], right = left, bottom = top;
+
+	for (int i = 1; i < count; i++) {
+		left = fminf(left, points[i * 2]);
+		right = fmaxf(right, points[i * 2]);
+		top = fminf(top, points[i * 2 + 1]);
+		bottom = fmaxf(bottom, points[i * 2 + 1]);
+	}
+
+	return cullRect(NULL, left - pad, top - pad, right + pad, bottom + pad);
+
+}
+
+static float strokePad(bool fill) {
+
+	// How far a stroke can reach past its points, at the longest miter
+
+	return fill ? 0 : lineWidth * SHAPE_MITER_LIMIT / 2;
+
+}
+
 static int graphicsSetBackgroundColor(lua_State *L) { // love.graphics.setBackgroundColor()
 
 	int r = luaL_checkinteger(L, 1);
@@ -159,28 +279,38 @@ static int graphicsGetColor(lua_State *L) { // love.graphics.getColor()
 
 }
 
+static void drawOutline(const float *points, int count, bool closed) {
+
+	float *strip = shapeScratch(1, SHAPE_STROKE_POINTS(count) * 2);
+	if (!strip) return;
+
+	int vertices = shapeStroke(points, count, closed, lineWidth, lineJoin, strip);
+
+	sf2d_draw_vertices(strip, vertices, GPU_TRIANGLE_STRIP, getCurrentColor());
+
+}
+
 static int graphicsRectangle(lua_State *L) { // love.graphics.rectangle()
 
 	if (sf2d_get_current_screen() == currentScreen) {
 
 		const char *mode = luaL_checkstring(L, 1);
 
-		int x = luaL_checkinteger(L, 2);
-		int y = luaL_checkinteger(L, 3);
+		float x = luaL_checknumber(L, 2);
+		float y = luaL_checknumber(L, 3);
+		float w = luaL_checknumber(L, 4);
+		float h = luaL_checknumber(L, 5);
 
-		translateCoords(&x, &y);
+		float pad = strokePad(strcmp(mode, "line") != 0);
+		if (cullRect(NULL, fminf(x, x + w) - pad, fminf(y, y + h) - pad, fmaxf(x, x + w) + pad, fmaxf(y, y + h) + pad)) return 0;
 
-		int w = luaL_checkinteger(L, 4);
-		int h = luaL_checkinteger(L, 5);
+		applyTransform();
 
 		if (strcmp(mode, "fill") == 0) {
-			sf2d_draw_rectangle(x, y, w, h, getCurrentColor());
+			sf2d_draw_rectangle_transform(x, y, w, h, NULL, getCurrentColor());
 		} else if (strcmp(mode, "line") == 0) {
-			sf2d_draw_line(x, y, x, y + h, getCurrentColor());
-			sf2d_draw_line(x, y, x + w, y, getCurrentColor());
-
-			sf2d_draw_line(x + w, y, x + w, y + h, getCurrentColor());
-			sf2d_draw_line(x, y + h, x + w, y + h, getCurrentColor());
+			float points[8] = { x, y, x + w, y, x + w, y + h, x, y + h };
+			drawOutline(points, 4, true);
 		}
 
 	}
@@ -189,23 +319,108 @@ static int graphicsRectangle(lua_State *L) { // love.graphics.rectangle()
 
 }
 
+static float transformScale() {
+
+	// How much the current transform scales lengths, for picking curve detail
+
+	const float *m = transformStack[transformDepth].m;
+
+	return sqrtf(fabsf(m[0] * m[4] - m[1] * m[3]));
+
+}
+
+static bool checkShapeMode(lua_State *L, int index) { // true for "fill", false for "line"
+
+	const char *mode = luaL_checkstring(L, index);
+
+	if (strcmp(mode, "fill") == 0) return true;
+	if (strcmp(mode, "line") != 0) luaL_error(L, "Invalid draw mode '%s', expected 'fill' or 'line'", mode);
+
+	return false;
+
+}
+
+static int checkSegments(lua_State *L, int index, float radius) {
+
+	if (lua_isnoneornil(L, index)) return shapeSegments(radius * transformScale());
+
+	int segments = luaL_checkinteger(L, index);
+
+	if (segments < 3) segments = 3;
+	if (segments > SHAPE_MAX_SEGMENTS) segments = SHAPE_MAX_SEGMENTS;
+
+	return segments;
+
+}
+
+static void drawPolygon(bool fill, const float *points, int count) {
+
+	if (!fill) {
+		drawOutline(points, count, true);
+	} else if (shapeConvex(points, count)) {
+		sf2d_draw_vertices(points, count, GPU_TRIANGLE_FAN, getCurrentColor());
+	} else {
+		float *triangles = shapeScratch(1, (count - 2) * 6);
+		if (!triangles) return;
+
+		int vertices = shapeTriangulate(points, count, triangles);
+
+		sf2d_draw_vertices(triangles, vertices, GPU_TRIANGLES, getCurrentColor());
+	}
+
+}
+
+static void drawEllipse(lua_State *L, bool fill, float x, float y, float rx, float ry, int segmentsIndex) {
+
+	float pad = strokePad(fill);
+	if (cullRect(NULL, x - fabsf(rx) - pad, y - fabsf(ry) - pad, x + fabsf(rx) + pad, y + fabsf(ry) + pad)) return;
+
+	int segments = checkSegments(L, segmentsIndex, fmaxf(fabsf(rx), fabsf(ry)));
+
+	float *points = shapeScratch(0, segments * 2);
+	if (!points) return;
+
+	shapeEllipse(points, x, y, rx, ry, segments);
+
+	applyTransform();
+
+	// Ellipses are convex, so they fan out from their first point
+	if (fill) {
+		sf2d_draw_vertices(points, segments, GPU_TRIANGLE_FAN, getCurrentColor());
+	} else {
+		drawOutline(points, segments, true);
+	}
+
+}
+
 static int graphicsCircle(lua_State *L) { // love.graphics.circle()
 
 	if (sf2d_get_current_screen() == currentScreen) {
 
-		int step = 15;
-		(void) step;
+		bool fill = checkShapeMode(L, 1);
+		float x = luaL_checknumber(L, 2);
+		float y = luaL_checknumber(L, 3);
+		float r = luaL_checknumber(L, 4);
 
-		const char *mode = luaL_checkstring(L, 1);
-		(void) mode;
-		int x = luaL_checkinteger(L, 2);
-		int y = luaL_checkinteger(L, 3);
-		int r = luaL_checkinteger(L, 4);
+		drawEllipse(L, fill, x, y, r, r, 5);
+
+	}
+
+	return 0;
+
+}
+
+static int graphicsEllipse(lua_State *L) { // love.graphics.ellipse()
+
+	if (sf2d_get_current_screen() == currentScreen) {
 
-		translateCoords(&x, &y);
+		bool fill = checkShapeMode(L, 1);
+		float x = luaL_checknumber(L, 2);
+		float y = luaL_checknumber(L, 3);
+		float rx = luaL_checknumber(L, 4);
+		float ry = luaL_optnumber(L, 5, rx);
 
-		sf2d_draw_line(x, y, x, y, RGBA8(0x00, 0x00, 0x00, 0x00)); // Fixes weird circle bug.
-		sf2d_draw_fill_circle(x, y, r, getCurrentColor());
+		drawEllipse(L, fill, x, y, rx, ry, 6);
 
 	}
 
@@ -213,31 +428,155 @@ static int graphicsCircle(lua_State *L) { // love.graphics.circle()
 
 }
 
-static int graphicsLine(lua_State *L) { // love.graphics.line() -- Semi-Broken
+static int graphicsArc(lua_State *L) { // love.graphics.arc()
 
 	if (sf2d_get_current_screen() == currentScreen) {
 
-		int argc = lua_gettop(L);
-		int i = 0;
+		bool fill = checkShapeMode(L, 1);
 
-		if ((argc/2)*2 == argc) {
-			for(; i < argc / 2; i++) {
+		// Optional arc type after the mode, as in LOVE 0.10.1
+		const char *type = "pie";
+		int start = 2;
 
-				int t = i * 4;
+		if (lua_type(L, 2) == LUA_TSTRING) {
+			type = lua_tostring(L, 2);
+			start = 3;
+		}
+
+		bool pie = strcmp(type, "pie") == 0;
+		bool open = strcmp(type, "open") == 0;
+
+		if (!pie && !open && strcmp(type, "closed") != 0) luaL_error(L, "Invalid arc type '%s', expected 'pie', 'open' or 'closed'", type);
 
-				int x1 = luaL_checkinteger(L, t + 1);
-				int y1 = luaL_checkinteger(L, t + 2);
-				int x2 = luaL_checkinteger(L, t + 3);
-				int y2 = luaL_checkinteger(L, t + 4);
+		float x = luaL_checknumber(L, start + 0);
+		float y = luaL_checknumber(L, start + 1);
+		float r = luaL_checknumber(L, start + 2);
+		float angle1 = luaL_checknumber(L, start + 3);
+		float angle2 = luaL_checknumber(L, start + 4);
 
-				translateCoords(&x1, &y1);
-				translateCoords(&x2, &y2);
+		if (angle1 == angle2) return 0;
 
-				sf2d_draw_line(x1, y1, x2, y2, getCurrentColor());
+		float pad = strokePad(fill) + fabsf(r);
+		if (cullRect(NULL, x - pad, y - pad, x + pad, y + pad)) return 0;
+
+		// A full circle's worth of detail, spread over the arc's angle
+		int segments;
+
+		if (lua_isnoneornil(L, start + 5)) {
+			segments = ceilf(shapeSegments(r * transformScale()) * fabsf(angle2 - angle1) / (2 * M_PI));
+		} else {
+			segments = luaL_checkinteger(L, start + 5);
+		}
+
+		if (segments < 1) segments = 1;
+		if (segments > SHAPE_MAX_SEGMENTS) segments = SHAPE_MAX_SEGMENTS;
+
+		// Pie arcs start with the center, then the points along the arc
+		float *points = shapeScratch(0, (segments + 2) * 2);
+		if (!points) return 0;
+
+		int count = 0;
+
+		if (pie) {
+			points[0] = x;
+			points[1] = y;
+			count = 1;
+		}
+
+		count += shapeArc(&points[count * 2], x, y, r, angle1, angle2, segments);
+
+		applyTransform();
+
+		if (fill) {
+			sf2d_draw_vertices(points, count, GPU_TRIANGLE_FAN, getCurrentColor());
+		} else {
+			drawOutline(points, count, !open);
+		}
 
+	}
+
+	return 0;
+
+}
+
+static int graphicsPolygon(lua_State *L) { // love.graphics.polygon()
+
+	if (sf2d_get_current_screen() == currentScreen) {
+
+		bool fill = checkShapeMode(L, 1);
+
+		bool table = lua_istable(L, 2);
+		int args = table ? lua_rawlen(L, 2) : lua_gettop(L) - 1;
+
+		if (args % 2 != 0) luaL_error(L, "Number of vertex components must be a multiple of two");
+		if (args < 6) luaL_error(L, "Need at least three vertices to draw a polygon");
+
+		int count = args / 2;
+
+		float *points = shapeScratch(0, args);
+		if (!points) return 0;
+
+		for (int i = 0; i < args; i++) {
+
+			if (table) {
+				lua_rawgeti(L, 2, i + 1);
+				points[i] = luaL_checknumber(L, -1);
+				lua_pop(L, 1);
+			} else {
+				points[i] = luaL_checknumber(L, i + 2);
 			}
+
 		}
 
+		// LOVE lets the last vertex repeat the first
+		if (points[0] == points[args - 2] && points[1] == points[args - 1]) count--;
+
+		if (count < 3) return 0;
+
+		if (cullPoints(points, count, strokePad(fill))) return 0;
+
+		applyTransform();
+
+		drawPolygon(fill, points, count);
+
+	}
+
+	return 0;
+
+}
+
+static int graphicsLine(lua_State *L) { // love.graphics.line()
+
+	if (sf2d_get_current_screen() == currentScreen) {
+
+		bool table = lua_istable(L, 1);
+		int args = table ? lua_rawlen(L, 1) : lua_gettop(L);
+
+		if (args % 2 != 0) luaL_error(L, "Number of vertex components must be a multiple of two");
+		if (args < 4) luaL_error(L, "Need at least two vertices to draw a line");
+
+		float *points = shapeScratch(0, args);
+		if (!points) return 0;
+
+		for (int i = 0; i < args; i++) {
+
+			if (table) {
+				lua_rawgeti(L, 1, i + 1);
+				points[i] = luaL_checknumber(L, -1);
+				lua_pop(L, 1);
+			} else {
+				points[i] = luaL_checknumber(L, i + 1);
+			}
+
+		}
+
+		if (cullPoints(points, args / 2, strokePad(false))) return 0;
+
+		applyTransform();
+
+		// The whole polyline is one triangle strip
+		drawOutline(points, args / 2, false);
+
 	}
 
 	return 0;
@@ -270,6 +609,45 @@ static int graphicsSetScreen(lua_State *L) { // love.graphics.setScreen()
 
 }
 
+static int graphicsSetScreenStatic(lua_State *L) { // love.graphics.setScreenStatic()
+
+	const char *name = luaL_checkstring(L, 1);
+	bool enable = lua_isnoneornil(L, 2) || lua_toboolean(L, 2);
+
+	gfxScreen_t screen;
+
+	if (strcmp(name, "top") == 0) {
+		screen = GFX_TOP;
+	} else if (strcmp(name, "bottom") == 0) {
+		screen = GFX_BOTTOM;
+	} else {
+		return luaL_error(L, "Invalid screen '%s', expected 'top' or 'bottom'", name);
+	}
+
+	// Marking a static screen again redraws it once with the new content
+	screenStatic[screen] = enable;
+	screenInvalidate(screen);
+
+	return 0;
+
+}
+
+static int graphicsIsScreenStatic(lua_State *L) { // love.graphics.isScreenStatic()
+
+	const char *name = luaL_checkstring(L, 1);
+
+	if (strcmp(name, "top") == 0) {
+		lua_pushboolean(L, screenStatic[GFX_TOP]);
+	} else if (strcmp(name, "bottom") == 0) {
+		lua_pushboolean(L, screenStatic[GFX_BOTTOM]);
+	} else {
+		return luaL_error(L, "Invalid screen '%s', expected 'top' or 'bottom'", name);
+	}
+
+	return 1;
+
+}
+
 static int graphicsGetSide(lua_State *L) { // love.graphics.getSide()
 
 	if (sf2d_get_current_side() == GFX_LEFT) {
@@ -286,10 +664,63 @@ static int graphicsPresent(lua_State *L) { // love.graphics.present()
 
 	sf2d_swapbuffers();
 
+	for (int i = GFX_TOP; i <= GFX_BOTTOM; i++) {
+		if (screenStatic[i] && !screenDrawn[i]) {
+			gfxSetDoubleBuffering(i, false);
+			screenDrawn[i] = true;
+		}
+	}
+
+	sftd_get_stats(&textStats);
+	sftd_reset_stats();
+
+	culledStats = culled;
+	culled = 0;
+
 	return 0;
 
 }
 
+static int graphicsGetStats(lua_State *L) { // love.graphics.getStats()
+
+	sf2d_stats stats;
+	sf2d_get_stats(&stats);
+
+	// Reuse the given table so per-frame polling doesn't make garbage
+	if (lua_istable(L, 1)) {
+		lua_settop(L, 1);
+	} else {
+		lua_createtable(L, 0, 8);
+	}
+
+	lua_pushinteger(L, stats.draw_calls);
+	lua_setfield(L, -2, "drawcalls");
+
+	lua_pushinteger(L, stats.vertices);
+	lua_setfield(L, -2, "vertices");
+
+	lua_pushinteger(L, stats.texture_binds);
+	lua_setfield(L, -2, "texturebinds");
+
+	lua_pushinteger(L, stats.texenv_changes);
+	lua_setfield(L, -2, "texenvchanges");
+
+	lua_pushinteger(L, stats.pool_bytes);
+	lua_setfield(L, -2, "poolbytes");
+
+	lua_pushinteger(L, textStats.glyphs);
+	lua_setfield(L, -2, "glyphs");
+
+	lua_pushinteger(L, textStats.atlas_misses);
+	lua_setfield(L, -2, "atlasmisses");
+
+	lua_pushinteger(L, culledStats);
+	lua_setfield(L, -2, "culled");
+
+	return 1;
+
+}
+
 static int graphicsGetWidth(lua_State *L) { // love.graphics.getWidth()
 
 	int topWidth = 400;
@@ -325,72 +756,203 @@ static int graphicsGetHeight(lua_State *L) { // love.graphics.getHeight()
 
 }
 
+static void drawTransform(lua_State *L, int start, float *local) {
+
+	// x, y, r, sx, sy, ox, oy arguments of love.graphics.draw as one matrix
+
+	float x = luaL_optnumber(L, start + 0, 0);
+	float y = luaL_optnumber(L, start + 1, 0);
+	float rad = luaL_optnumber(L, start + 2, 0);
+	float sx = luaL_optnumber(L, start + 3, 1);
+	float sy = luaL_optnumber(L, start + 4, sx);
+	float ox = luaL_optnumber(L, start + 5, 0);
+	float oy = luaL_optnumber(L, start + 6, 0);
+
+	float c = cosf(rad), s = sinf(rad);
+
+	local[0] = c * sx;
+	local[1] = -s * sy;
+	local[2] = x - local[0] * ox - local[1] * oy;
+	local[3] = s * sx;
+	local[4] = c * sy;
+	local[5] = y - local[3] * ox - local[4] * oy;
+
+}
+
+void particleSystemDraw(love_particlesystem *self, const float *m, u32 color);
+void meshDraw(love_mesh *self, const float *m, u32 color);
+
 static int graphicsDraw(lua_State *L) { // love.graphics.draw()
 
 	if (sf2d_get_current_screen() == currentScreen) {
 
+		float local[6];
+
+		love_particlesystem *ps = luaobj_testudata(L, 1, LUAOBJ_TYPE_PARTICLESYSTEM);
+
+		if (ps) {
+
+			drawTransform(L, 2, local);
+			applyTransform();
+
+			particleSystemDraw(ps, local, getCurrentColor());
+
+			return 0;
+
+		}
+
+		love_mesh *mesh = luaobj_testudata(L, 1, LUAOBJ_TYPE_MESH);
+
+		if (mesh) {
+
+			drawTransform(L, 2, local);
+			applyTransform();
+
+			meshDraw(mesh, local, getCurrentColor());
+
+			return 0;
+
+		}
+
 		love_image *img = luaobj_checkudata(L, 1, LUAOBJ_TYPE_IMAGE);
 		love_quad *quad = NULL;
 
-		int x, y;
-		int sx, sy;
-		float rad;
+		int start = 2;
 
 		if (!lua_isnone(L, 2) && lua_type(L, 2) != LUA_TNUMBER) {
 
 			quad = luaobj_checkudata(L, 2, LUAOBJ_TYPE_QUAD);
-			x = luaL_optnumber(L, 3, 0);
-			y = luaL_optnumber(L, 4, 0);
-			rad = luaL_optnumber(L, 5, 0);
-			sx = luaL_optnumber(L, 6, 0);
-			sy = luaL_optnumber(L, 7, 0);
+			start = 3;
 
-		} else {
+		}
 
-			x = luaL_optnumber(L, 2, 0);
-			y = luaL_optnumber(L, 3, 0);
-			rad = luaL_optnumber(L, 4, 0);
-			sx = luaL_optnumber(L, 5, 0);
-			sy = luaL_optnumber(L, 6, 0);
+		drawTransform(L, start, local);
 
+		if (!img->texture) return 0;
+
+		if (cullRect(local, 0, 0, quad ? quad->width : img->texture->width, quad ? quad->height : img->texture->height)) return 0;
+
+		applyTransform();
+
+		if (!quad) {
+			sf2d_draw_texture_part_transform_blend(img->texture, 0, 0, 0, 0, img->texture->width, img->texture->height, local, getCurrentColor());
+		} else {
+			sf2d_draw_texture_part_transform_blend(img->texture, 0, 0, quad->x, quad->y, quad->width, quad->height, local, getCurrentColor());
 		}
 
-		translateCoords(&x, &y);
-
-		if (rad == 0) {
-			
-            if (sx == 0 && sy == 0){
-				
-			    if (!quad) {
-
-				    if (img) {
-					    sf2d_draw_texture_blend(img->texture, x, y, getCurrentColor());
-				    }
-				
-			    } else {
-				    sf2d_draw_texture_part_blend(img->texture, x, y, quad->x, quad->y, quad->width, quad->height, getCurrentColor());
-			    }
-				
-			} else {
-				
-				if (!quad) {
-
-				    if (img) {
-					    sf2d_draw_texture_scale_blend(img->texture, x, y, sx, sy, getCurrentColor());
-				    }
-				
-			    } else {
-				    sf2d_draw_texture_part_scale_blend(img->texture, x, y, quad->x, quad->y, quad->width, quad->height, sx, sy, getCurrentColor());
-			    }
-				
+	}
+
+	return 0;
+
+}
+
+#define DRAWMANY_STRIDE 6 // x, y, r, sx, sy, quad index (0 or no quad table draws the whole image)
+
+static float drawManyField(lua_State *L, int index) {
+
+	lua_rawgeti(L, 3, index);
+
+	if (!lua_isnumber(L, -1)) luaL_error(L, "Bad sprite array value at index %d (number expected)", index);
+
+	float value = lua_tonumber(L, -1);
+	lua_pop(L, 1);
+
+	return value;
+
+}
+
+static int graphicsDrawMany(lua_State *L) { // love.graphics.drawMany()
+
+	if (sf2d_get_current_screen() == currentScreen) {
+
+		love_image *img = luaobj_checkudata(L, 1, LUAOBJ_TYPE_IMAGE);
+
+		bool hasQuads = !lua_isnoneornil(L, 2);
+
+		if (hasQuads) luaL_checktype(L, 2, LUA_TTABLE);
+		luaL_checktype(L, 3, LUA_TTABLE);
+
+		float ox = luaL_optnumber(L, 4, 0);
+		float oy = luaL_optnumber(L, 5, 0);
+
+		int len = lua_rawlen(L, 3);
+
+		if (len % DRAWMANY_STRIDE != 0) luaL_error(L, "Sprite array length must be a multiple of %d (x, y, r, sx, sy, quad)", DRAWMANY_STRIDE);
+
+		if (!img->texture) return 0;
+
+		// Sprites are gathered here and handed to sf2d a draw call's worth at a time
+		static sf2d_sprite sprites[SF2D_SPRITES_PER_DRAW];
+		int count = 0;
+
+		love_quad whole = { 0, 0, img->texture->width, img->texture->height };
+		love_quad *quad = &whole;
+		int quadIndex = 0;
+
+		float m[6];
+		cullMatrix(NULL, m);
+
+		applyTransform();
+
+		for (int i = 1; i <= len; i += DRAWMANY_STRIDE) {
+
+			sf2d_sprite *sp = &sprites[count];
+
+			sp->x = drawManyField(L, i + 0);
+			sp->y = drawManyField(L, i + 1);
+			sp->rad = drawManyField(L, i + 2);
+			sp->sx = drawManyField(L, i + 3);
+			sp->sy = drawManyField(L, i + 4);
+			sp->ox = ox;
+			sp->oy = oy;
+
+			if (hasQuads) {
+
+				int index = drawManyField(L, i + 5);
+
+				if (index < 0) luaL_error(L, "Bad quad index %d at sprite array index %d", index, i + 5);
+
+				// Runs of sprites usually share a quad, so only look it up when it changes
+				if (index == 0) {
+
+					quad = &whole;
+					quadIndex = 0;
+
+				} else if (index != quadIndex) {
+
+					lua_rawgeti(L, 2, index);
+
+					if (!lua_isuserdata(L, -1)) luaL_error(L, "No quad at index %d of the quad table", index);
+
+					quad = luaobj_checkudata(L, -1, LUAOBJ_TYPE_QUAD);
+					quadIndex = index;
+					lua_pop(L, 1);
+
+				}
+
 			}
 
-		} else {
-            
-			sf2d_draw_texture_rotate_blend(img->texture, x + img->texture->width / 2, y + img->texture->height / 2, rad, getCurrentColor());
+			sp->tex_x = quad->x;
+			sp->tex_y = quad->y;
+			sp->tex_w = quad->width;
+			sp->tex_h = quad->height;
+
+			// Whatever the rotation, the sprite stays within this radius of its position
+			float rx = fmaxf(fabsf(ox), fabsf(quad->width - ox)) * fabsf(sp->sx);
+			float ry = fmaxf(fabsf(oy), fabsf(quad->height - oy)) * fabsf(sp->sy);
+			float radius = sqrtf(rx * rx + ry * ry);
+
+			if (cullBox(m, sp->x - radius, sp->y - radius, sp->x + radius, sp->y + radius)) continue;
+
+			if (++count == SF2D_SPRITES_PER_DRAW) {
+				sf2d_draw_texture_sprites_blend(img->texture, sprites, count, getCurrentColor());
+				count = 0;
+			}
 
 		}
 
+		sf2d_draw_texture_sprites_blend(img->texture, sprites, count, getCurrentColor());
+
 	}
 
 	return 0;
@@ -405,6 +967,25 @@ static int graphicsSetFont(lua_State *L) { // love.graphics.setFont()
 
 }
 
+static bool cullText(const char *text, float x, float y, int width) {
+
+	// A loose box, glyphs reach a bit past their advance and below the baseline.
+	// Without a known width (0) each character counts as one size wide, and
+	// wrapped text can break at every space.
+
+	int size = currentFont->size;
+	int lines = 1;
+
+	if (width) {
+		for (const char *c = text; *c; c++) lines += *c == ' ';
+	} else {
+		width = strlen(text) * size;
+	}
+
+	return cullRect(NULL, x - size, y - size / 2, x + width + size, y + (lines + 1) * size);
+
+}
+
 static int graphicsPrint(lua_State *L) { // love.graphics.print()
 
 	if (sf2d_get_current_screen() == currentScreen) {
@@ -412,10 +993,12 @@ static int graphicsPrint(lua_State *L) { // love.graphics.print()
 		if (currentFont) {
 
 			const char *printText = luaL_checkstring(L, 1);
-			int x = luaL_checkinteger(L, 2);
-			int y = luaL_checkinteger(L, 3);
+			float x = luaL_checknumber(L, 2);
+			float y = luaL_checknumber(L, 3);
 
-			translateCoords(&x, &y);
+			if (cullText(printText, x, y, 0)) return 0;
+
+			applyTransform();
 
 			sftd_draw_text(currentFont->font, x, y, getCurrentColor(), currentFont->size, printText);
 
@@ -434,8 +1017,8 @@ static int graphicsPrintFormat(lua_State *L) {
 		if (currentFont) {
 
 			const char *printText = luaL_checkstring(L, 1);
-			int x = luaL_checkinteger(L, 2);
-			int y = luaL_checkinteger(L, 3);
+			float x = luaL_checknumber(L, 2);
+			float y = luaL_checknumber(L, 3);
 			int limit = luaL_checkinteger(L, 4);
 			const char *align = luaL_optstring(L, 5, "left");
 
@@ -455,7 +1038,9 @@ static int graphicsPrintFormat(lua_State *L) {
 
 			}
 
-			translateCoords(&x, &y);
+			if (cullText(printText, x, y, width > limit ? width : limit)) return 0;
+
+			applyTransform();
 
 			if (x > 0) limit += x; // Quick text wrap fix, needs removing once sf2dlib is updated.
 
@@ -473,7 +1058,10 @@ static int graphicsPush(lua_State *L) { // love.graphics.push()
 
 	if (sf2d_get_current_screen() == currentScreen) {
 
-		isPushed = true;
+		if (transformDepth + 1 >= TRANSFORM_STACK_DEPTH) luaU_error(L, "Maximum stack depth reached (more pushes than pops?)");
+
+		transformStack[transformDepth + 1] = transformStack[transformDepth];
+		transformDepth++;
 
 	}
 
@@ -485,9 +1073,9 @@ static int graphicsPop(lua_State *L) { // love.graphics.pop()
 
 	if (sf2d_get_current_screen() == currentScreen) {
 
-		currentState.transform.translation.x = 0;
-		currentState.transform.translation.y = 0;
-		isPushed = false;
+		if (transformDepth < 1) luaU_error(L, "Minimum stack depth reached (more pops than pushes?)");
+
+		transformDepth--;
 
 	}
 
@@ -499,8 +1087,7 @@ static int graphicsOrigin(lua_State *L) { // love.graphics.origin()
 
 	if (sf2d_get_current_screen() == currentScreen) {
 
-		currentState.transform.translation.x = 0;
-		currentState.transform.translation.y = 0;
+		transformIdentity(transformStack[transformDepth].m);
 
 	}
 
@@ -512,11 +1099,59 @@ static int graphicsTranslate(lua_State *L) { // love.graphics.translate()
 
 	if (sf2d_get_current_screen() == currentScreen) {
 
-		int dx = luaL_checkinteger(L, 1);
-		int dy = luaL_checkinteger(L, 2);
+		float dx = luaL_checknumber(L, 1);
+		float dy = luaL_checknumber(L, 2);
 
-		currentState.transform.translation.x = currentState.transform.translation.x + dx;
-		currentState.transform.translation.y = currentState.transform.translation.y + dy;
+		float t[6] = { 1, 0, dx, 0, 1, dy };
+		transformMultiply(transformStack[transformDepth].m, t);
+
+	}
+
+	return 0;
+
+}
+
+static int graphicsRotate(lua_State *L) { // love.graphics.rotate()
+
+	if (sf2d_get_current_screen() == currentScreen) {
+
+		float rad = luaL_checknumber(L, 1);
+		float c = cosf(rad), s = sinf(rad);
+
+		float t[6] = { c, -s, 0, s, c, 0 };
+		transformMultiply(transformStack[transformDepth].m, t);
+
+	}
+
+	return 0;
+
+}
+
+static int graphicsScale(lua_State *L) { // love.graphics.scale()
+
+	if (sf2d_get_current_screen() == currentScreen) {
+
+		float sx = luaL_checknumber(L, 1);
+		float sy = luaL_optnumber(L, 2, sx);
+
+		float t[6] = { sx, 0, 0, 0, sy, 0 };
+		transformMultiply(transformStack[transformDepth].m, t);
+
+	}
+
+	return 0;
+
+}
+
+static int graphicsShear(lua_State *L) { // love.graphics.shear()
+
+	if (sf2d_get_current_screen() == currentScreen) {
+
+		float kx = luaL_checknumber(L, 1);
+		float ky = luaL_checknumber(L, 2);
+
+		float t[6] = { 1, kx, 0, ky, 1, 0 };
+		transformMultiply(transformStack[transformDepth].m, t);
 
 	}
 
@@ -529,6 +1164,8 @@ static int graphicsSet3D(lua_State *L) { // love.graphics.set3D()
 	is3D = lua_toboolean(L, 1);
 	sf2d_set_3D(is3D);
 
+	screenInvalidate(GFX_TOP); // The right eye has to be drawn too
+
 	return 0;
 
 }
@@ -559,18 +1196,42 @@ static int graphicsGetDepth(lua_State *L) { // love.graphics.getDepth()
 
 static int graphicsSetLineWidth(lua_State *L) { // love.graphics.setLineWidth()
 
-	// TODO: Do this properly
+	float width = luaL_checknumber(L, 1);
+
+	if (width <= 0) luaL_error(L, "Line width must be positive");
+
+	lineWidth = width;
+
 	return 0;
 
 }
 
 static int graphicsGetLineWidth(lua_State *L) { // love.graphics.getLineWidth()
 
-	// TODO: This too.
+	lua_pushnumber(L, lineWidth);
+
+	return 1;
+
+}
+
+static const char *lineJoinNames[] = { "miter", "bevel", "none", NULL };
+
+static int graphicsSetLineJoin(lua_State *L) { // love.graphics.setLineJoin()
+
+	lineJoin = luaL_checkoption(L, 1, NULL, lineJoinNames);
+
 	return 0;
 
 }
 
+static int graphicsGetLineJoin(lua_State *L) { // love.graphics.getLineJoin()
+
+	lua_pushstring(L, lineJoinNames[lineJoin]);
+
+	return 1;
+
+}
+
 static int graphicsSetDefaultFilter(lua_State *L) { // love.graphics.setDefaultFilter()
 
 	const char *minMode = luaL_checkstring(L, 1);
@@ -613,6 +1274,8 @@ static int graphicsGetDefaultFilter(lua_State *L) { // love.graphics.getDefaultF
 int imageNew(lua_State *L);
 int fontNew(lua_State *L);
 int quadNew(lua_State *L);
+int particleSystemNew(lua_State *L);
+int meshNew(lua_State *L);
 
 const char *fontDefaultInit(love_font *self, int size);
 
@@ -620,15 +1283,16 @@ int initLoveGraphics(lua_State *L) {
 
 	luaL_Reg reg[] = {
 		/** Drawing **/
-		//{ "arc",				graphicsArc					},
+		{ "arc",				graphicsArc					},
 		{ "circle",				graphicsCircle				},
 		//{ "clear",				graphicsClear				},
 		//{ "discard",			graphicsDiscard				},
 		{ "draw",				graphicsDraw				},
-		//{ "ellipse",			graphicsEllipse				},
+		{ "drawMany",			graphicsDrawMany			},
+		{ "ellipse",			graphicsEllipse				},
 		{ "line",				graphicsLine				},
 		//{ "points",				graphicsPoints				},
-		//{ "polygon",			graphicsPolygon				},
+		{ "polygon",			graphicsPolygon				},
 		{ "present",			graphicsPresent				},
 		{ "print",				graphicsPrint				},
 		{ "printf",				graphicsPrintFormat			},
@@ -640,8 +1304,8 @@ int initLoveGraphics(lua_State *L) {
 		{ "newFont",			fontNew						},
 		{ "newImage",			imageNew					},
 		//{ "newImageFont",		imageFontNew				},
-		//{ "newMesh",			meshNew						},
-		//{ "newParticleSystem",	particleSystemNew			},
+		{ "newMesh",			meshNew						},
+		{ "newParticleSystem",	particleSystemNew			},
 		{ "newQuad",			quadNew						},
 		//{ "newScreenshot",		screenshotNew				},
 		//{ "newShader",			shaderNew					},
@@ -660,8 +1324,11 @@ int initLoveGraphics(lua_State *L) {
 		{ "setBackgroundColor",	graphicsSetBackgroundColor	},
 		{ "setColor",			graphicsSetColor			},
 		
+		{ "getStats",			graphicsGetStats			},
 		{ "getScreen",			graphicsGetScreen			},
 		{ "setScreen",			graphicsSetScreen			},
+		{ "setScreenStatic",	graphicsSetScreenStatic		},
+		{ "isScreenStatic",		graphicsIsScreenStatic		},
 		{ "getSide",			graphicsGetSide				},
 		{ "getWidth",			graphicsGetWidth			},
 		{ "getHeight",			graphicsGetHeight			},
@@ -670,17 +1337,24 @@ int initLoveGraphics(lua_State *L) {
 		{ "pop",				graphicsPop					},
 		{ "origin",				graphicsOrigin				},
 		{ "translate",			graphicsTranslate			},
+		{ "rotate",				graphicsRotate				},
+		{ "scale",				graphicsScale				},
+		{ "shear",				graphicsShear				},
 		{ "set3D",				graphicsSet3D				},
 		{ "get3D",				graphicsGet3D				},
 		{ "setDepth",			graphicsSetDepth			},
 		{ "getDepth",			graphicsGetDepth			},
-		// { "setLineWidth",		graphicsSetLineWidth		},
-		// { "getLineWidth",		graphicsGetLineWidth		},
+		{ "setLineWidth",		graphicsSetLineWidth		},
+		{ "getLineWidth",		graphicsGetLineWidth		},
+		{ "setLineJoin",		graphicsSetLineJoin			},
+		{ "getLineJoin",		graphicsGetLineJoin			},
 		{ "setDefaultFilter",	graphicsSetDefaultFilter	},
 		{ "getDefaultFilter",	graphicsGetDefaultFilter	},
 		{ 0, 0 },
 	};
 
+	resetTransformStack();
+
 	luaL_newlib(L, reg);
 
 	return 1;
@@ -39,11 +39,16 @@ int initLoveMouse(lua_State *L);
 int initLoveWindow(lua_State *L);
 int initLoveEvent(lua_State *L);
 int initLoveAudio(lua_State *L);
+int initLoveSound(lua_State *L);
+int initLoveProfiler(lua_State *L);
 
 int initImageClass(lua_State *L);
 int initFontClass(lua_State *L);
 int initSourceClass(lua_State *L);
 int initQuadClass(lua_State *L);
+int initSoundDataClass(lua_State *L);
+int initParticleSystemClass(lua_State *L);
+int initMeshClass(lua_State *L);
 
 void finiLoveSystem();
 
@@ -58,6 +63,9 @@ int initLove(lua_State *L) {
 		initFontClass,
 		initSourceClass,
 		initQuadClass,
+		initSoundDataClass,
+		initParticleSystemClass,
+		initMeshClass,
 		NULL,
 	};
 
@@ -82,6 +90,8 @@ int initLove(lua_State *L) {
 		{ "window",   initLoveWindow    },
 		{ "event",    initLoveEvent     },
 		{ "audio",    initLoveAudio     },
+		{ "sound",    initLoveSound     },
+		{ "profiler", initLoveProfiler  },
 		{ 0 },
 	};
 
@@ -0,0 +1,330 @@
+// This code is licensed under the MIT Open Source License.
+
+// Copyright (c) 2015 Ruairidh Carmichael - ruairidhcarmichael@live.co.uk
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../shared.h"
+
+// Sampling profiler: a count hook walks the Lua stack every N VM
+// instructions and counts identical stacks in C tables, so sampling
+// never allocates Lua objects. dump() writes collapsed stacks
+// ("outer;inner count" lines) for flamegraph.pl, speedscope and co.
+
+#define PROFILER_DEFAULT_COUNT 10000 // VM instructions between samples
+#define PROFILER_MAX_DEPTH 64
+#define PROFILER_FRAMES 4096 // Power of two
+#define PROFILER_STACKS 8192 // Power of two
+#define PROFILER_STACK_POOL 65536 // Frame ids shared by all stacks
+#define PROFILER_LABELS 65536 // Bytes of frame labels
+
+struct ProfilerFrame {
+
+	const void *key; // Source string of a Lua function, C function pointer
+	int line; // Line defined, tells apart functions of the same chunk
+	u32 label; // Offset into labels
+
+};
+
+struct ProfilerStack {
+
+	u32 hash;
+	u32 start; // Offset into stackPool, innermost frame first
+	u16 depth;
+	u32 samples;
+
+};
+
+struct Profiler {
+
+	struct ProfilerFrame frames[PROFILER_FRAMES];
+	struct ProfilerStack stacks[PROFILER_STACKS];
+	u16 stackPool[PROFILER_STACK_POOL];
+	char labels[PROFILER_LABELS];
+
+	int frameCount, stackCount;
+	u32 stackPoolUsed, labelsUsed;
+
+	u32 samples, dropped;
+
+};
+
+static struct Profiler *profiler = NULL;
+static lua_State *profiledState = NULL;
+static bool profilerRunning = false; // Coroutines keep the hook after stop()
+
+static u32 hashPointer(const void *p, int line) {
+
+	u32 h = (u32)p ^ ((u32)line * 2654435761u);
+	return h ^ (h >> 15);
+
+}
+
+static u32 profilerLabel(lua_Debug *info) {
+
+	char label[128];
+
+	if (*info->what == 'C') {
+		snprintf(label, sizeof(label), "%s [C]", info->name ? info->name : "?");
+	} else if (*info->what == 't') {
+		snprintf(label, sizeof(label), "(tail call)");
+	} else if (*info->what == 'm') {
+		snprintf(label, sizeof(label), "main chunk (%s)", info->short_src);
+	} else {
+		snprintf(label, sizeof(label), "%s (%s:%d)", info->name ? info->name : "?", info->short_src, info->linedefined);
+	}
+
+	// ';' separates frames in the collapsed format
+	for (char *c = label; *c; c++) {
+		if (*c == ';') *c = ':';
+	}
+
+	u32 size = strlen(label) + 1;
+
+	if (profiler->labelsUsed + size > PROFILER_LABELS) return 0; // The empty label at offset 0
+
+	u32 offset = profiler->labelsUsed;
+	memcpy(profiler->labels + offset, label, size);
+	profiler->labelsUsed += size;
+
+	return offset;
+
+}
+
+static int profilerFrame(lua_State *L, lua_Debug *info) { // Frame id, -1 if the table is full
+
+	lua_getinfo(L, "S", info);
+
+	const void *key = info->source;
+	int line = info->linedefined;
+
+	if (*info->what == 'C') {
+		lua_getinfo(L, "f", info);
+		key = (const void *)lua_tocfunction(L, -1);
+		lua_pop(L, 1);
+	}
+
+	u32 i = hashPointer(key, line) & (PROFILER_FRAMES - 1);
+
+	for (;;) {
+
+		struct ProfilerFrame *frame = &profiler->frames[i];
+
+		if (frame->key == key && frame->line == line) return i;
+
+		if (!frame->key) {
+
+			// Keep a quarter free so probing stays short
+			if (profiler->frameCount >= PROFILER_FRAMES * 3 / 4) return -1;
+
+			lua_getinfo(L, "n", info);
+
+			frame->key = key;
+			frame->line = line;
+			frame->label = profilerLabel(info);
+			profiler->frameCount++;
+
+			return i;
+
+		}
+
+		i = (i + 1) & (PROFILER_FRAMES - 1);
+
+	}
+
+}
+
+static void profilerCount(const u16 *ids, int depth) {
+
+	u32 hash = 2166136261u;
+	for (int i = 0; i < depth; i++) hash = (hash ^ ids[i]) * 16777619u;
+
+	u32 i = hash & (PROFILER_STACKS - 1);
+
+	for (;;) {
+
+		struct ProfilerStack *stack = &profiler->stacks[i];
+
+		if (stack->samples == 0) break;
+
+		if (stack->hash == hash && stack->depth == depth &&
+			memcmp(profiler->stackPool + stack->start, ids, depth * sizeof(u16)) == 0) {
+				stack->samples++;
+				profiler->samples++;
+				return;
+		}
+
+		i = (i + 1) & (PROFILER_STACKS - 1);
+
+	}
+
+	if (profiler->stackCount >= PROFILER_STACKS * 3 / 4 ||
+		profiler->stackPoolUsed + depth > PROFILER_STACK_POOL) {
+			profiler->dropped++;
+			return;
+	}
+
+	struct ProfilerStack *stack = &profiler->stacks[i];
+
+	stack->hash = hash;
+	stack->start = profiler->stackPoolUsed;
+	stack->depth = depth;
+	stack->samples = 1;
+
+	memcpy(profiler->stackPool + stack->start, ids, depth * sizeof(u16));
+	profiler->stackPoolUsed += depth;
+	profiler->stackCount++;
+	profiler->samples++;
+
+}
+
+static void profilerHook(lua_State *L, lua_Debug *ar) {
+
+	if (!profilerRunning) {
+		lua_sethook(L, NULL, 0, 0);
+		return;
+	}
+
+	u16 ids[PROFILER_MAX_DEPTH];
+	int depth = 0;
+
+	lua_Debug info;
+
+	// Deeper frames than PROFILER_MAX_DEPTH are cut off at the outer end
+	for (int level = 0; depth < PROFILER_MAX_DEPTH && lua_getstack(L, level, &info); level++) {
+
+		int id = profilerFrame(L, &info);
+
+		if (id < 0) {
+			profiler->dropped++;
+			return;
+		}
+
+		ids[depth++] = id;
+
+	}
+
+	if (depth > 0) profilerCount(ids, depth);
+
+}
+
+// These take the calling thread as T, it may be a coroutine of the main state L
+static int profilerStart(lua_State *T) { // love.profiler.start()
+
+	int count = luaL_optinteger(T, 1, PROFILER_DEFAULT_COUNT);
+
+	if (count < 1) luaL_error(T, "Sample interval must be at least 1 instruction");
+
+	if (!profiler) {
+		profiler = malloc(sizeof(struct Profiler));
+		if (!profiler) luaL_error(T, "Not enough memory for the profiler");
+	}
+
+	memset(profiler, 0, sizeof(struct Profiler));
+	profiler->labelsUsed = 1; // Offset 0 is the empty label
+
+	// Coroutines created from now on inherit the hook
+	if (profiledState) lua_sethook(profiledState, NULL, 0, 0);
+	profiledState = L;
+	lua_sethook(profiledState, profilerHook, LUA_MASKCOUNT, count);
+
+	if (T != profiledState) lua_sethook(T, profilerHook, LUA_MASKCOUNT, count);
+
+	profilerRunning = true;
+
+	return 0;
+
+}
+
+static int profilerStop(lua_State *T) { // love.profiler.stop()
+
+	// Other coroutines drop the hook the next time it fires
+	profilerRunning = false;
+
+	if (profiledState) lua_sethook(profiledState, NULL, 0, 0);
+	if (T != profiledState) lua_sethook(T, NULL, 0, 0);
+
+	profiledState = NULL;
+
+	lua_pushinteger(T, profiler ? profiler->samples : 0);
+
+	return 1;
+
+}
+
+static int profilerDump(lua_State *L) { // love.profiler.dump()
+
+	const char *filename = luaL_optstring(L, 1, "profile.txt");
+
+	if (!profiler) luaL_error(L, "The profiler has not been started");
+
+	FILE *file = fopen(filename, "w");
+
+	if (!file) {
+		lua_pushnil(L);
+		lua_pushfstring(L, "Could not open '%s'", filename);
+		return 2;
+	}
+
+	for (int i = 0; i < PROFILER_STACKS; i++) {
+
+		struct ProfilerStack *stack = &profiler->stacks[i];
+
+		if (stack->samples == 0) continue;
+
+		// Outermost frame first
+		for (int j = stack->depth - 1; j >= 0; j--) {
+			struct ProfilerFrame *frame = &profiler->frames[profiler->stackPool[stack->start + j]];
+			fputs(profiler->labels + frame->label, file);
+			if (j > 0) fputc(';', file);
+		}
+
+		fprintf(file, " %lu\n", (unsigned long)stack->samples);
+
+	}
+
+	bool failed = ferror(file);
+
+	if (fclose(file) != 0 || failed) {
+		lua_pushnil(L);
+		lua_pushfstring(L, "Could not write '%s'", filename);
+		return 2;
+	}
+
+	lua_pushinteger(L, profiler->samples);
+	lua_pushinteger(L, profiler->dropped);
+
+	return 2;
+
+}
+
+int initLoveProfiler(lua_State *L) {
+
+	luaL_Reg reg[] = {
+		{ "start",	profilerStart	},
+		{ "stop",	profilerStop	},
+		{ "dump",	profilerDump	},
+		{ 0, 0 },
+	};
+
+	luaL_newlib(L, reg);
+
+	return 1;
+
+}
@@ -21,14 +21,61 @@
 // THE SOFTWARE.
 
 #include "../shared.h"
+#include "../trace.h"
 
 int roundNumber(float num) {
     return num < 0 ? num - 0.5 : num + 0.5;
 }
 
-int prevTime = 0;
-int currTime = 0;
-float dt;
+#define TICKS_PER_SECOND ((double)SYSCLOCK_ARM11)
+
+u64 startTick = 0;
+u64 prevTick = 0;
+u64 currTick = 0;
+double dt = 0;
+
+// Fixed timestep driver, off while fixedStep is 0
+double fixedStep = 0;
+int fixedMaxSteps = 5;
+double fixedAccumulator = 0;
+
+double timerGetSeconds() { // Seconds since love.timer was initialised
+
+	return (svcGetSystemTick() - startTick) / TICKS_PER_SECOND;
+
+}
+
+int timerFixedSteps() { // Number of fixed updates to run this frame, -1 if the driver is off
+
+	if (fixedStep <= 0) return -1;
+
+	fixedAccumulator += dt;
+
+	int steps = fixedAccumulator / fixedStep;
+
+	// Drop the backlog instead of spiralling when updates can't keep up
+	if (steps > fixedMaxSteps) {
+		steps = fixedMaxSteps;
+		fixedAccumulator = fmod(fixedAccumulator, fixedStep);
+	} else {
+		fixedAccumulator -= steps * fixedStep;
+	}
+
+	return steps;
+
+}
+
+double timerFixedAlpha() { // How far between two fixed updates we draw
+
+	return fixedStep > 0 ? fixedAccumulator / fixedStep : 1;
+
+}
+
+double timerFixedStep() {
+
+	return fixedStep;
+
+}
 
 static int timerFPS(lua_State *L) { // love.timer.getFPS()
 
@@ -40,9 +87,7 @@ static int timerFPS(lua_State *L) { // love.timer.getFPS()
 
 static int timerGetTime(lua_State *L) { // love.timer.getTime()
 
-	int m = osGetTime();
-
-	lua_pushnumber(L, m * 0.001);
+	lua_pushnumber(L, timerGetSeconds());
 
 	return 1;
 
@@ -50,18 +95,88 @@ static int timerGetTime(lua_State *L) { // love.timer.getTime()
 
 static int timerStep(lua_State *L) { // love.timer.step()
 
-	prevTime = currTime;
+	prevTick = currTick;
 
-	currTime = osGetTime();
+	currTick = svcGetSystemTick();
 
-	dt = currTime - prevTime;
+	dt = (currTick - prevTick) / TICKS_PER_SECOND;
 
-	dt = dt * 0.001;
+	return 0;
+
+}
+
+static int timerSetFixedStep(lua_State *L) { // love.timer.setFixedStep()
+
+	double step = luaL_checknumber(L, 1);
+	int maxSteps = luaL_optinteger(L, 2, 5);
+
+	if (step < 0) luaL_error(L, "Fixed step must not be negative");
+	if (maxSteps < 1) luaL_error(L, "Maximum steps must be at least 1");
+
+	fixedStep = step;
+	fixedMaxSteps = maxSteps;
+	fixedAccumulator = 0;
 
 	return 0;
 
 }
 
+static int timerGetFixedStep(lua_State *L) { // love.timer.getFixedStep()
+
+	lua_pushnumber(L, fixedStep);
+	lua_pushinteger(L, fixedMaxSteps);
+
+	return 2;
+
+}
+
+static int timerZone(lua_State *L) { // love.timer.zone()
+
+	const char *name = luaL_checkstring(L, 1);
+	luaL_checktype(L, 2, LUA_TFUNCTION);
+
+	const char *zone = traceActive() ? traceIntern(name) : NULL;
+
+	if (zone) traceBegin(zone);
+
+	int status = lua_pcall(L, lua_gettop(L) - 2, LUA_MULTRET, 0);
+
+	if (zone) traceEnd(zone);
+
+	if (status) return lua_error(L);
+
+	return lua_gettop(L) - 1; // Everything the function returned
+
+}
+
+static int timerStartTrace(lua_State *L) { // love.timer.startTrace()
+
+	traceStart();
+
+	lua_pushboolean(L, traceActive());
+
+	return 1;
+
+}
+
+static int timerStopTrace(lua_State *L) { // love.timer.stopTrace()
+
+	const char *filename = luaL_optstring(L, 1, "trace.json");
+
+	int written = traceStop(filename);
+
+	if (written < 0) {
+		lua_pushnil(L);
+		lua_pushfstring(L, "Could not write trace to '%s'", filename);
+		return 2;
+	}
+
+	lua_pushinteger(L, written);
+
+	return 1;
+
+}
+
 static int timerGetDelta() { // love.timer.getDelta()
 
 	if (dt < 0) dt = 0; // Fix nasty timer bug
@@ -74,11 +189,20 @@ static int timerGetDelta() { // love.timer.getDelta()
 
 int initLoveTimer(lua_State *L) {
 
+	// The first step measures from here, not from boot
+	startTick = svcGetSystemTick();
+	currTick = startTick;
+
 	luaL_Reg reg[] = {
 		{ "getFPS",		timerFPS		},
 		{ "getTime",	timerGetTime	},
 		{ "step",		timerStep		},
 		{ "getDelta",	timerGetDelta	},
+		{ "setFixedStep",	timerSetFixedStep	},
+		{ "getFixedStep",	timerGetFixedStep	},
+		{ "zone",		timerZone		},
+		{ "startTrace",	timerStartTrace	},
+		{ "stopTrace",	timerStopTrace	},
 		{ 0, 0 },
 	};
 
@@ -0,0 +1,639 @@
+// This code is licensed under the MIT Open Source License.
+
+// Copyright (c) 2015 Ruairidh Carmichael - ruairidhcarmichael@live.co.uk
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../shared.h"
+#include "../util.h"
+
+#define CLASS_TYPE  LUAOBJ_TYPE_MESH
+#define CLASS_NAME  "Mesh"
+
+// Fields of a vertex in flat arrays given to setVertices
+#define MESH_VERTEX_STRIDE 8
+
+static const char *meshModeNames[] = { "fan", "strip", "triangles", NULL };
+static const GPU_Primitive_t meshModes[] = { GPU_TRIANGLE_FAN, GPU_TRIANGLE_STRIP, GPU_TRIANGLES };
+
+static u16 *meshBufferIndices(love_mesh *self, love_mesh_buffer *buffer) {
+
+	return (u16*)((sf2d_vertex_packed*)buffer->data + self->count);
+
+}
+
+static bool meshBufferBusy(love_mesh_buffer *buffer) {
+
+	return buffer->drawnFrame > sf2d_get_rendered_frame();
+
+}
+
+static void meshLayout(love_mesh *self, love_mesh_buffer *buffer) {
+
+	// Positions are packed around the middle of the mesh, in SF2D_PACKED_SUBPIXELS
+	// steps, or coarser ones for meshes too large for s16 at that precision
+
+	love_mesh_vertex *v = self->vertices;
+	float left = v[0].x, right = left, top = v[0].y, bottom = top;
+
+	for (int i = 1; i < self->count; i++) {
+		left = fminf(left, v[i].x);
+		right = fmaxf(right, v[i].x);
+		top = fminf(top, v[i].y);
+		bottom = fmaxf(bottom, v[i].y);
+	}
+
+	buffer->origin[0] = roundf((left + right) / 2);
+	buffer->origin[1] = roundf((top + bottom) / 2);
+
+	float extent = fmaxf(right - left, bottom - top) / 2 + 1;
+
+	buffer->unit = SF2D_PACKED_SUBPIXELS;
+	while (extent * buffer->unit > 32767 && buffer->unit > 1.0f / 1024) buffer->unit /= 2;
+
+}
+
+static s16 meshPackCoord(float value) {
+
+	value = roundf(value);
+
+	if (value < -32768) return -32768;
+	if (value > 32767) return 32767;
+
+	return (s16)value;
+
+}
+
+static bool meshPackVertices(love_mesh *self, love_mesh_buffer *buffer, int first, int count) {
+
+	// false when a position doesn't fit the buffer's layout
+	sf2d_texture *texture = self->image ? self->image->texture : NULL;
+
+	// Texture coordinates are relative to the image, not its power-of-two texture
+	float su = texture ? (float)texture->width / texture->pow2_w * SF2D_PACKED_UV_ONE : 0;
+	float sv = texture ? (float)texture->height / texture->pow2_h * SF2D_PACKED_UV_ONE : 0;
+
+	float ox = buffer->origin[0], oy = buffer->origin[1], unit = buffer->unit;
+
+	sf2d_vertex_packed *out = (sf2d_vertex_packed*)buffer->data + first;
+	love_mesh_vertex *in = self->vertices + first;
+
+	for (int i = 0; i < count; i++) {
+
+		float x = (in[i].x - ox) * unit;
+		float y = (in[i].y - oy) * unit;
+
+		if (fabsf(x) > 32767 || fabsf(y) > 32767) return false;
+
+		out[i].x = meshPackCoord(x);
+		out[i].y = meshPackCoord(y);
+		out[i].u = meshPackCoord(in[i].u * su);
+		out[i].v = meshPackCoord(in[i].v * sv);
+		out[i].color = in[i].color;
+
+	}
+
+	return true;
+
+}
+
+static void meshPack(love_mesh *self, love_mesh_buffer *buffer, int first, int count) {
+
+	// Vertices that moved out of range lay the whole buffer out again
+	if (!meshPackVertices(self, buffer, first, count)) {
+		meshLayout(self, buffer);
+		meshPackVertices(self, buffer, 0, self->count);
+		first = 0;
+		count = self->count;
+	}
+
+	GSPGPU_FlushDataCache((sf2d_vertex_packed*)buffer->data + first, count * sizeof(sf2d_vertex_packed));
+
+}
+
+static void meshPackIndices(love_mesh *self, love_mesh_buffer *buffer) {
+
+	if (!self->indexCount) return;
+
+	u16 *indices = meshBufferIndices(self, buffer);
+
+	memcpy(indices, self->indices, self->indexCount * sizeof(u16));
+	GSPGPU_FlushDataCache(indices, self->indexCount * sizeof(u16));
+
+}
+
+static int meshAllocBuffer(love_mesh *self, love_mesh_buffer *buffer) {
+
+	// 0 when the buffer already fits, 1 when it was (re)allocated, -1 without memory
+	if (buffer->data && buffer->indexCapacity >= self->indexCount) return 0;
+
+	if (buffer->data) linearFree(buffer->data);
+
+	buffer->data = linearAlloc(self->count * sizeof(sf2d_vertex_packed) + self->indexCapacity * sizeof(u16));
+	buffer->indexCapacity = self->indexCapacity;
+
+	return buffer->data ? 1 : -1;
+
+}
+
+static bool meshBeginWrite(love_mesh *self) {
+
+	// Brings a buffer the GPU is done with up to date and makes it current, for the
+	// caller to pack its change into. Without one the mesh goes stale: changes only
+	// reach the CPU copy, and draws pack it into sf2d's frame pool until a buffer is free.
+
+	love_mesh_buffer *current = &self->buffers[self->current];
+
+	int b = meshBufferBusy(current) ? !self->current : self->current;
+	love_mesh_buffer *buffer = &self->buffers[b];
+
+	int alloc = meshBufferBusy(buffer) ? -1 : meshAllocBuffer(self, buffer);
+
+	if (alloc < 0) {
+		self->stale = true;
+		return false;
+	}
+
+	if (buffer == current && !self->stale && alloc == 0) return true;
+
+	if (buffer != current && !self->stale && current->data) {
+		// Cheaper than packing: the current buffer only lacks the caller's change
+		memcpy(buffer->data, current->data, self->count * sizeof(sf2d_vertex_packed));
+		GSPGPU_FlushDataCache(buffer->data, self->count * sizeof(sf2d_vertex_packed));
+		buffer->origin[0] = current->origin[0];
+		buffer->origin[1] = current->origin[1];
+		buffer->unit = current->unit;
+	} else {
+		meshLayout(self, buffer);
+		meshPack(self, buffer, 0, self->count);
+	}
+
+	meshPackIndices(self, buffer);
+
+	self->current = b;
+	self->stale = false;
+
+	return true;
+
+}
+
+static void meshReadVertex(lua_State *L, int index, love_mesh_vertex *vertex) {
+
+	// {x, y, u, v, r, g, b, a}, as in LOVE
+	float v[MESH_VERTEX_STRIDE];
+
+	for (int i = 0; i < MESH_VERTEX_STRIDE; i++) {
+		lua_rawgeti(L, index, i + 1);
+		v[i] = luaL_optnumber(L, -1, i < 4 ? 0 : 255);
+		lua_pop(L, 1);
+	}
+
+	vertex->x = v[0];
+	vertex->y = v[1];
+	vertex->u = v[2];
+	vertex->v = v[3];
+	vertex->color = RGBA8((int)v[4], (int)v[5], (int)v[6], (int)v[7]);
+
+}
+
+static int meshPushVertex(lua_State *L, love_mesh_vertex *vertex) {
+
+	lua_pushnumber(L, vertex->x);
+	lua_pushnumber(L, vertex->y);
+	lua_pushnumber(L, vertex->u);
+	lua_pushnumber(L, vertex->v);
+	lua_pushinteger(L, RGBA8_GET_R(vertex->color));
+	lua_pushinteger(L, RGBA8_GET_G(vertex->color));
+	lua_pushinteger(L, RGBA8_GET_B(vertex->color));
+	lua_pushinteger(L, RGBA8_GET_A(vertex->color));
+
+	return MESH_VERTEX_STRIDE;
+
+}
+
+static int meshVerticesCount(lua_State *L, int index, bool *flat) {
+
+	// Either a table of vertex tables or one flat array of MESH_VERTEX_STRIDE numbers per vertex
+	int length = lua_objlen(L, index);
+
+	lua_rawgeti(L, index, 1);
+	*flat = lua_type(L, -1) == LUA_TNUMBER;
+	lua_pop(L, 1);
+
+	if (!*flat) return length;
+
+	if (length % MESH_VERTEX_STRIDE != 0) luaU_error(L, "Flat vertex arrays need 8 numbers per vertex");
+
+	return length / MESH_VERTEX_STRIDE;
+
+}
+
+static int meshSetVerticesFrom(lua_State *L, love_mesh *self, int index, int start) {
+
+	bool flat;
+	int count = meshVerticesCount(L, index, &flat);
+
+	if (start < 0 || start + count > self->count) luaU_error(L, "Too many vertices for this Mesh");
+
+	for (int i = 0; i < count; i++) {
+
+		love_mesh_vertex *vertex = &self->vertices[start + i];
+
+		if (flat) {
+
+			float v[MESH_VERTEX_STRIDE];
+			for (int k = 0; k < MESH_VERTEX_STRIDE; k++) {
+				lua_rawgeti(L, index, i * MESH_VERTEX_STRIDE + k + 1);
+				v[k] = lua_tonumber(L, -1);
+				lua_pop(L, 1);
+			}
+
+			vertex->x = v[0];
+			vertex->y = v[1];
+			vertex->u = v[2];
+			vertex->v = v[3];
+			vertex->color = RGBA8((int)v[4], (int)v[5], (int)v[6], (int)v[7]);
+
+		} else {
+
+			lua_rawgeti(L, index, i + 1);
+			luaL_checktype(L, -1, LUA_TTABLE);
+			meshReadVertex(L, lua_gettop(L), vertex);
+			lua_pop(L, 1);
+
+		}
+
+	}
+
+	return count;
+
+}
+
+static int meshMapIndex(lua_State *L, bool fromTable, int i) {
+
+	if (!fromTable) return luaL_checkinteger(L, i + 2);
+
+	lua_rawgeti(L, 2, i + 1);
+	int index = lua_tointeger(L, -1);
+	lua_pop(L, 1);
+
+	return index;
+
+}
+
+void meshDraw(love_mesh *self, const float *m, u32 color) { // love.graphics.draw(mesh)
+
+	sf2d_texture *texture = self->image ? self->image->texture : NULL;
+	int total = self->indexCount ? self->indexCount : self->count;
+
+	int first = 0;
+	int count = total;
+
+	if (self->rangeCount) {
+		first = self->rangeStart < total ? self->rangeStart : total;
+		count = self->rangeCount < total - first ? self->rangeCount : total - first;
+	}
+
+	if (count <= 0) return;
+
+	if (self->stale) meshBeginWrite(self);
+
+	love_mesh_buffer *buffer = &self->buffers[self->current];
+	love_mesh_buffer frame;
+
+	if (self->stale) {
+
+		// Both buffers are still in use, this draw packs its own copy in the frame pool
+		frame.data = sf2d_pool_memalign(self->count * sizeof(sf2d_vertex_packed) + self->indexCount * sizeof(u16), 8);
+		if (!frame.data) return;
+
+		meshLayout(self, &frame);
+		meshPackVertices(self, &frame, 0, self->count);
+		if (self->indexCount) memcpy(meshBufferIndices(self, &frame), self->indices, self->indexCount * sizeof(u16));
+
+		buffer = &frame;
+
+	}
+
+	// Packed positions back to the mesh's own coordinates, then the draw's transform
+	float unit = 1 / buffer->unit, ox = buffer->origin[0], oy = buffer->origin[1];
+	float pm[6] = { unit, 0, ox, 0, unit, oy };
+
+	if (m) {
+		pm[0] = m[0] * unit;
+		pm[1] = m[1] * unit;
+		pm[2] = m[0] * ox + m[1] * oy + m[2];
+		pm[3] = m[3] * unit;
+		pm[4] = m[4] * unit;
+		pm[5] = m[3] * ox + m[4] * oy + m[5];
+	}
+
+	sf2d_draw_vertices_packed(texture, buffer->data, self->indexCount ? meshBufferIndices(self, buffer) : NULL, first, count, self->mode, pm, color);
+
+	buffer->drawnFrame = sf2d_get_frame_count();
+
+}
+
+int meshNew(lua_State *L) { // love.graphics.newMesh()
+
+	bool fromTable = lua_istable(L, 1);
+	bool flat;
+	int count = fromTable ? meshVerticesCount(L, 1, &flat) : luaL_checkinteger(L, 1);
+	int mode = luaL_checkoption(L, 2, "fan", meshModeNames);
+
+	// Vertex map entries are 16-bit
+	if (count < 1 || count > 65536) luaU_error(L, "Mesh vertex count must be between 1 and 65536");
+
+	love_mesh *self = luaobj_newudata(L, sizeof(*self));
+	luaobj_setclass(L, CLASS_TYPE, CLASS_NAME);
+
+	memset(self, 0, sizeof(*self));
+
+	self->imageRef = LUA_NOREF;
+	self->mode = meshModes[mode];
+	self->count = count;
+
+	self->vertices = malloc(count * sizeof(love_mesh_vertex));
+	if (!self->vertices) luaU_error(L, "Could not allocate Mesh buffer");
+
+	for (int i = 0; i < count; i++) self->vertices[i] = (love_mesh_vertex){ 0, 0, 0, 0, 0xFFFFFFFF };
+
+	if (fromTable) meshSetVerticesFrom(L, self, 1, 0);
+
+	if (!meshBeginWrite(self)) luaU_error(L, "Could not allocate Mesh buffer");
+
+	return 1;
+
+}
+
+int meshGC(lua_State *L) { // Garbage Collection
+
+	love_mesh *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	if (meshBufferBusy(&self->buffers[0]) || meshBufferBusy(&self->buffers[1])) sf2d_wait_gpu();
+
+	for (int i = 0; i < 2; i++) {
+		if (self->buffers[i].data) linearFree(self->buffers[i].data);
+		self->buffers[i].data = NULL;
+	}
+
+	free(self->vertices);
+	self->vertices = NULL;
+	free(self->indices);
+	self->indices = NULL;
+	self->count = 0;
+	self->indexCount = 0;
+
+	luaL_unref(L, LUA_REGISTRYINDEX, self->imageRef);
+	self->imageRef = LUA_NOREF;
+
+	return 0;
+
+}
+
+int meshSetVertex(lua_State *L) { // mesh:setVertex()
+
+	love_mesh *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	int i = luaL_checkinteger(L, 2) - 1;
+
+	if (i < 0 || i >= self->count) luaU_error(L, "Invalid vertex index");
+
+	love_mesh_vertex *vertex = &self->vertices[i];
+
+	if (lua_istable(L, 3)) {
+		meshReadVertex(L, 3, vertex);
+	} else {
+		vertex->x = luaL_checknumber(L, 3);
+		vertex->y = luaL_checknumber(L, 4);
+		vertex->u = luaL_optnumber(L, 5, 0);
+		vertex->v = luaL_optnumber(L, 6, 0);
+		vertex->color = RGBA8(luaL_optinteger(L, 7, 255), luaL_optinteger(L, 8, 255), luaL_optinteger(L, 9, 255), luaL_optinteger(L, 10, 255));
+	}
+
+	if (meshBeginWrite(self)) meshPack(self, &self->buffers[self->current], i, 1);
+
+	return 0;
+
+}
+
+int meshGetVertex(lua_State *L) { // mesh:getVertex()
+
+	love_mesh *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	int i = luaL_checkinteger(L, 2) - 1;
+
+	if (i < 0 || i >= self->count) luaU_error(L, "Invalid vertex index");
+
+	return meshPushVertex(L, &self->vertices[i]);
+
+}
+
+int meshSetVertices(lua_State *L) { // mesh:setVertices()
+
+	love_mesh *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	luaL_checktype(L, 2, LUA_TTABLE);
+	int start = luaL_optinteger(L, 3, 1) - 1;
+
+	int count = meshSetVerticesFrom(L, self, 2, start);
+
+	// Only the vertices that changed are packed and flushed
+	if (count > 0 && meshBeginWrite(self)) meshPack(self, &self->buffers[self->current], start, count);
+
+	return 0;
+
+}
+
+int meshGetVertexCount(lua_State *L) { // mesh:getVertexCount()
+
+	love_mesh *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	lua_pushinteger(L, self->count);
+
+	return 1;
+
+}
+
+int meshSetVertexMap(lua_State *L) { // mesh:setVertexMap()
+
+	love_mesh *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	// A table, the indices as arguments, or nothing to draw the vertices in order
+	bool fromTable = lua_istable(L, 2);
+	int count = lua_isnoneornil(L, 2) ? 0 : fromTable ? (int)lua_objlen(L, 2) : lua_gettop(L) - 1;
+
+	// Checked before anything is written, the current map stays on errors
+	for (int i = 0; i < count; i++) {
+		int index = meshMapIndex(L, fromTable, i);
+		if (index < 1 || index > self->count) luaU_error(L, "Invalid vertex map index");
+	}
+
+	if (count > self->indexCapacity) {
+		u16 *indices = realloc(self->indices, count * sizeof(u16));
+		if (!indices) luaU_error(L, "Could not allocate Mesh vertex map");
+
+		self->indices = indices;
+		self->indexCapacity = count;
+	}
+
+	for (int i = 0; i < count; i++) self->indices[i] = meshMapIndex(L, fromTable, i) - 1;
+	self->indexCount = count;
+
+	if (count > 0 && meshBeginWrite(self)) meshPackIndices(self, &self->buffers[self->current]);
+
+	return 0;
+
+}
+
+int meshGetVertexMap(lua_State *L) { // mesh:getVertexMap()
+
+	love_mesh *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	if (!self->indexCount) {
+		lua_pushnil(L);
+		return 1;
+	}
+
+	lua_createtable(L, self->indexCount, 0);
+	for (int i = 0; i < self->indexCount; i++) {
+		lua_pushinteger(L, self->indices[i] + 1);
+		lua_rawseti(L, -2, i + 1);
+	}
+
+	return 1;
+
+}
+
+int meshSetDrawRange(lua_State *L) { // mesh:setDrawRange()
+
+	love_mesh *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	if (lua_isnoneornil(L, 2)) {
+		self->rangeStart = 0;
+		self->rangeCount = 0;
+		return 0;
+	}
+
+	int start = luaL_checkinteger(L, 2);
+	int count = luaL_checkinteger(L, 3);
+
+	if (start < 1 || count < 1) luaU_error(L, "Invalid draw range");
+
+	self->rangeStart = start - 1;
+	self->rangeCount = count;
+
+	return 0;
+
+}
+
+int meshGetDrawRange(lua_State *L) { // mesh:getDrawRange()
+
+	love_mesh *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	if (!self->rangeCount) {
+		lua_pushnil(L);
+		return 1;
+	}
+
+	lua_pushinteger(L, self->rangeStart + 1);
+	lua_pushinteger(L, self->rangeCount);
+
+	return 2;
+
+}
+
+int meshSetDrawMode(lua_State *L) { // mesh:setDrawMode()
+
+	love_mesh *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	self->mode = meshModes[luaL_checkoption(L, 2, NULL, meshModeNames)];
+
+	return 0;
+
+}
+
+int meshGetDrawMode(lua_State *L) { // mesh:getDrawMode()
+
+	love_mesh *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	for (int i = 0; meshModeNames[i]; i++) {
+		if (meshModes[i] == self->mode) lua_pushstring(L, meshModeNames[i]);
+	}
+
+	return 1;
+
+}
+
+int meshSetTexture(lua_State *L) { // mesh:setTexture()
+
+	love_mesh *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	love_image *image = lua_isnoneornil(L, 2) ? NULL : luaobj_checkudata(L, 2, LUAOBJ_TYPE_IMAGE);
+
+	luaL_unref(L, LUA_REGISTRYINDEX, self->imageRef);
+	self->imageRef = LUA_NOREF;
+
+	if (image) {
+		lua_pushvalue(L, 2);
+		self->imageRef = luaL_ref(L, LUA_REGISTRYINDEX);
+	}
+
+	self->image = image;
+
+	// Packed texture coordinates depend on the texture size
+	if (meshBeginWrite(self)) meshPack(self, &self->buffers[self->current], 0, self->count);
+
+	return 0;
+
+}
+
+int meshGetTexture(lua_State *L) { // mesh:getTexture()
+
+	love_mesh *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	if (self->imageRef == LUA_NOREF) {
+		lua_pushnil(L);
+	} else {
+		lua_rawgeti(L, LUA_REGISTRYINDEX, self->imageRef);
+	}
+
+	return 1;
+
+}
+
+int initMeshClass(lua_State *L) {
+
+	luaL_Reg reg[] = {
+		{ "new",            meshNew            },
+		{ "__gc",           meshGC             },
+		{ "setVertex",      meshSetVertex      },
+		{ "getVertex",      meshGetVertex      },
+		{ "setVertices",    meshSetVertices    },
+		{ "getVertexCount", meshGetVertexCount },
+		{ "setVertexMap",   meshSetVertexMap   },
+		{ "getVertexMap",   meshGetVertexMap   },
+		{ "setDrawRange",   meshSetDrawRange   },
+		{ "getDrawRange",   meshGetDrawRange   },
+		{ "setDrawMode",    meshSetDrawMode    },
+		{ "getDrawMode",    meshGetDrawMode    },
+		{ "setTexture",     meshSetTexture     },
+		{ "getTexture",     meshGetTexture     },
+		{ 0, 0 },
+	};
+
+	luaobj_newclass(L, CLASS_NAME, NULL, meshNew, reg);
+
+	return 1;
+
+}
@@ -0,0 +1,744 @@
+// This code is licensed under the MIT Open Source License.
+
+// Copyright (c) 2015 Ruairidh Carmichael - ruairidhcarmichael@live.co.uk
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../shared.h"
+#include "../util.h"
+
+#include <limits.h>
+
+#define CLASS_TYPE  LUAOBJ_TYPE_PARTICLESYSTEM
+#define CLASS_NAME  "ParticleSystem"
+
+#define PARTICLE_MAX (INT_MAX / (PARTICLE_ARRAYS * (int)sizeof(float))) // Keeps the buffer size from wrapping
+
+// Sprites and colors of one sf2d draw call, reused by every system
+static sf2d_sprite drawSprites[SF2D_SPRITES_PER_DRAW];
+static u32 drawColors[SF2D_SPRITES_PER_DRAW];
+
+static float particleRandom(love_particlesystem *self) { // [0, 1)
+
+	// xorshift32, cheap enough to call several times per spawned particle
+	u32 x = self->seed;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	self->seed = x;
+
+	return (x >> 8) * (1.0f / 16777216.0f);
+
+}
+
+static float particleRange(love_particlesystem *self, float min, float max) {
+
+	return min + (max - min) * particleRandom(self);
+
+}
+
+static void particleSetArrays(love_particlesystem *self) {
+
+	float **arrays[PARTICLE_ARRAYS] = {
+		&self->x, &self->y, &self->vx, &self->vy, &self->ax,
+		&self->ay, &self->rotation, &self->spin, &self->life, &self->lifetime
+	};
+
+	for (int i = 0; i < PARTICLE_ARRAYS; i++) *arrays[i] = self->data + i * self->capacity;
+
+}
+
+static const char *particleSetCapacity(love_particlesystem *self, int capacity) {
+
+	float *data = malloc(capacity * PARTICLE_ARRAYS * sizeof(float));
+	if (!data) return "Could not allocate particle buffer";
+
+	int count = self->count < capacity ? self->count : capacity;
+
+	if (self->data) {
+		for (int i = 0; i < PARTICLE_ARRAYS; i++) memcpy(data + i * capacity, self->data + i * self->capacity, count * sizeof(float));
+		free(self->data);
+	}
+
+	self->data = data;
+	self->capacity = capacity;
+	self->count = count;
+
+	particleSetArrays(self);
+
+	return NULL;
+
+}
+
+static void particleEmit(love_particlesystem *self, int n) {
+
+	if (n > self->capacity - self->count) n = self->capacity - self->count;
+
+	for (; n > 0; n--) {
+
+		int i = self->count++;
+
+		float angle = self->direction + self->spread * (particleRandom(self) - 0.5f);
+		float speed = particleRange(self, self->speedMin, self->speedMax);
+
+		self->x[i] = self->x0;
+		self->y[i] = self->y0;
+		self->vx[i] = cosf(angle) * speed;
+		self->vy[i] = sinf(angle) * speed;
+		self->ax[i] = particleRange(self, self->accelMin[0], self->accelMax[0]);
+		self->ay[i] = particleRange(self, self->accelMin[1], self->accelMax[1]);
+		self->rotation[i] = particleRange(self, self->rotationMin, self->rotationMax);
+		self->spin[i] = particleRange(self, self->spinMin, self->spinMax);
+		self->lifetime[i] = self->life[i] = particleRange(self, self->lifeMin, self->lifeMax);
+
+	}
+
+}
+
+static void particleUpdate(love_particlesystem *self, float dt) {
+
+	int i = 0;
+
+	while (i < self->count) {
+
+		self->life[i] -= dt;
+
+		if (self->life[i] <= 0) {
+
+			// Move the last particle into the dead one's slot
+			int last = --self->count;
+			for (int k = 0; k < PARTICLE_ARRAYS; k++) {
+				float *array = self->data + k * self->capacity;
+				array[i] = array[last];
+			}
+
+			continue;
+
+		}
+
+		i++;
+
+	}
+
+	// Short passes over the attribute arrays, read front to back
+	int count = self->count;
+	float *vx = self->vx, *vy = self->vy, *ax = self->ax, *ay = self->ay;
+	float *x = self->x, *y = self->y, *rotation = self->rotation, *spin = self->spin;
+
+	for (i = 0; i < count; i++) {
+		vx[i] += ax[i] * dt;
+		vy[i] += ay[i] * dt;
+	}
+
+	for (i = 0; i < count; i++) {
+		x[i] += vx[i] * dt;
+		y[i] += vy[i] * dt;
+		rotation[i] += spin[i] * dt;
+	}
+
+	if (self->active) {
+
+		self->emitCounter += dt * self->emissionRate;
+
+		int n = (int)self->emitCounter;
+		self->emitCounter -= n;
+		particleEmit(self, n);
+
+		if (self->emitterLifetime >= 0) {
+			self->emitterLife -= dt;
+			if (self->emitterLife <= 0) {
+				self->active = false;
+				self->emitterLife = self->emitterLifetime;
+				self->emitCounter = 0;
+			}
+		}
+
+	}
+
+}
+
+void particleSystemDraw(love_particlesystem *self, const float *m, u32 color) { // love.graphics.draw(particlesystem)
+
+	sf2d_texture *texture = self->image->texture;
+
+	if (!texture || self->count == 0) return;
+
+	float r = RGBA8_GET_R(color) / 255.0f;
+	float g = RGBA8_GET_G(color) / 255.0f;
+	float b = RGBA8_GET_B(color) / 255.0f;
+	float a = RGBA8_GET_A(color) / 255.0f;
+
+	int n = 0;
+
+	for (int i = 0; i < self->count; i++) {
+
+		// Position in the size and color lists over the particle's life
+		float t = self->lifetime[i] > 0 ? 1 - self->life[i] / self->lifetime[i] : 1;
+
+		float s = t * (self->sizeCount - 1);
+		int si = (int)s;
+		float size = si >= self->sizeCount - 1 ? self->sizes[self->sizeCount - 1] : self->sizes[si] + (self->sizes[si + 1] - self->sizes[si]) * (s - si);
+
+		float c = t * (self->colorCount - 1);
+		int ci = (int)c;
+		float mix = c - ci;
+		if (ci >= self->colorCount - 1) {
+			ci = self->colorCount - 1;
+			mix = 0;
+		}
+
+		const float *c0 = self->colors[ci];
+		const float *c1 = self->colors[ci + (mix > 0)];
+
+		drawColors[n] = RGBA8(
+			(int)((c0[0] + (c1[0] - c0[0]) * mix) * r),
+			(int)((c0[1] + (c1[1] - c0[1]) * mix) * g),
+			(int)((c0[2] + (c1[2] - c0[2]) * mix) * b),
+			(int)((c0[3] + (c1[3] - c0[3]) * mix) * a)
+		);
+
+		drawSprites[n] = (sf2d_sprite){
+			self->x[i], self->y[i], self->rotation[i], size, size, self->ox, self->oy,
+			0, 0, texture->width, texture->height
+		};
+
+		if (++n == SF2D_SPRITES_PER_DRAW) {
+			sf2d_draw_texture_sprites_color(texture, drawSprites, drawColors, n, m);
+			n = 0;
+		}
+
+	}
+
+	sf2d_draw_texture_sprites_color(texture, drawSprites, drawColors, n, m);
+
+}
+
+int particleSystemNew(lua_State *L) { // love.graphics.newParticleSystem()
+
+	love_image *image = luaobj_checkudata(L, 1, LUAOBJ_TYPE_IMAGE);
+	int capacity = luaL_optinteger(L, 2, 1000);
+
+	if (capacity < 1 || capacity > PARTICLE_MAX) luaU_error(L, "Invalid ParticleSystem max buffer size");
+
+	love_particlesystem *self = luaobj_newudata(L, sizeof(*self));
+	luaobj_setclass(L, CLASS_TYPE, CLASS_NAME);
+
+	memset(self, 0, sizeof(*self));
+
+	self->image = image;
+	lua_pushvalue(L, 1);
+	self->imageRef = luaL_ref(L, LUA_REGISTRYINDEX);
+
+	// Same defaults as LOVE
+	self->emitterLifetime = self->emitterLife = -1;
+	self->sizes[0] = 1;
+	self->sizeCount = 1;
+	self->colors[0][0] = self->colors[0][1] = self->colors[0][2] = self->colors[0][3] = 255;
+	self->colorCount = 1;
+	self->active = true;
+	self->seed = (u32)svcGetSystemTick() | 1;
+
+	if (image->texture) {
+		self->ox = image->texture->width / 2.0f;
+		self->oy = image->texture->height / 2.0f;
+	}
+
+	const char *error = particleSetCapacity(self, capacity);
+	if (error) luaU_error(L, error);
+
+	return 1;
+
+}
+
+int particleSystemGC(lua_State *L) { // Garbage Collection
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	free(self->data);
+	self->data = NULL;
+	self->count = 0;
+
+	luaL_unref(L, LUA_REGISTRYINDEX, self->imageRef);
+	self->imageRef = LUA_NOREF;
+
+	return 0;
+
+}
+
+int particleSystemUpdate(lua_State *L) { // particlesystem:update()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	float dt = luaL_checknumber(L, 2);
+
+	if (dt > 0) particleUpdate(self, dt);
+
+	return 0;
+
+}
+
+int particleSystemEmit(lua_State *L) { // particlesystem:emit()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	int n = luaL_checkinteger(L, 2);
+
+	if (n > 0) particleEmit(self, n);
+
+	return 0;
+
+}
+
+int particleSystemStart(lua_State *L) { // particlesystem:start()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	if (!self->paused) self->emitterLife = self->emitterLifetime;
+
+	self->active = true;
+	self->paused = false;
+
+	return 0;
+
+}
+
+int particleSystemStop(lua_State *L) { // particlesystem:stop()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	self->active = false;
+	self->paused = false;
+	self->emitterLife = self->emitterLifetime;
+	self->emitCounter = 0;
+
+	return 0;
+
+}
+
+int particleSystemPause(lua_State *L) { // particlesystem:pause()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	if (self->active) {
+		self->active = false;
+		self->paused = true;
+	}
+
+	return 0;
+
+}
+
+int particleSystemReset(lua_State *L) { // particlesystem:reset()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	self->count = 0;
+	self->emitterLife = self->emitterLifetime;
+	self->emitCounter = 0;
+
+	return 0;
+
+}
+
+int particleSystemIsActive(lua_State *L) { // particlesystem:isActive()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	lua_pushboolean(L, self->active);
+
+	return 1;
+
+}
+
+int particleSystemIsPaused(lua_State *L) { // particlesystem:isPaused()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	lua_pushboolean(L, self->paused);
+
+	return 1;
+
+}
+
+int particleSystemIsStopped(lua_State *L) { // particlesystem:isStopped()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	lua_pushboolean(L, !self->active && !self->paused);
+
+	return 1;
+
+}
+
+int particleSystemGetCount(lua_State *L) { // particlesystem:getCount()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	lua_pushinteger(L, self->count);
+
+	return 1;
+
+}
+
+int particleSystemSetBufferSize(lua_State *L) { // particlesystem:setBufferSize()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	int capacity = luaL_checkinteger(L, 2);
+
+	if (capacity < 1 || capacity > PARTICLE_MAX) luaU_error(L, "Invalid ParticleSystem max buffer size");
+
+	const char *error = particleSetCapacity(self, capacity);
+	if (error) luaU_error(L, error);
+
+	return 0;
+
+}
+
+int particleSystemGetBufferSize(lua_State *L) { // particlesystem:getBufferSize()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	lua_pushinteger(L, self->capacity);
+
+	return 1;
+
+}
+
+int particleSystemSetEmissionRate(lua_State *L) { // particlesystem:setEmissionRate()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	float rate = luaL_checknumber(L, 2);
+
+	if (rate < 0) luaU_error(L, "Invalid emission rate");
+
+	self->emissionRate = rate;
+
+	return 0;
+
+}
+
+int particleSystemGetEmissionRate(lua_State *L) { // particlesystem:getEmissionRate()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	lua_pushnumber(L, self->emissionRate);
+
+	return 1;
+
+}
+
+int particleSystemSetEmitterLifetime(lua_State *L) { // particlesystem:setEmitterLifetime()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	self->emitterLifetime = self->emitterLife = luaL_checknumber(L, 2);
+
+	return 0;
+
+}
+
+int particleSystemGetEmitterLifetime(lua_State *L) { // particlesystem:getEmitterLifetime()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	lua_pushnumber(L, self->emitterLifetime);
+
+	return 1;
+
+}
+
+int particleSystemSetParticleLifetime(lua_State *L) { // particlesystem:setParticleLifetime()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	self->lifeMin = luaL_checknumber(L, 2);
+	self->lifeMax = luaL_optnumber(L, 3, self->lifeMin);
+
+	return 0;
+
+}
+
+int particleSystemGetParticleLifetime(lua_State *L) { // particlesystem:getParticleLifetime()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	lua_pushnumber(L, self->lifeMin);
+	lua_pushnumber(L, self->lifeMax);
+
+	return 2;
+
+}
+
+int particleSystemSetPosition(lua_State *L) { // particlesystem:setPosition()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	self->x0 = luaL_checknumber(L, 2);
+	self->y0 = luaL_checknumber(L, 3);
+
+	return 0;
+
+}
+
+int particleSystemGetPosition(lua_State *L) { // particlesystem:getPosition()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	lua_pushnumber(L, self->x0);
+	lua_pushnumber(L, self->y0);
+
+	return 2;
+
+}
+
+int particleSystemSetDirection(lua_State *L) { // particlesystem:setDirection()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	self->direction = luaL_checknumber(L, 2);
+
+	return 0;
+
+}
+
+int particleSystemGetDirection(lua_State *L) { // particlesystem:getDirection()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	lua_pushnumber(L, self->direction);
+
+	return 1;
+
+}
+
+int particleSystemSetSpread(lua_State *L) { // particlesystem:setSpread()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	self->spread = luaL_checknumber(L, 2);
+
+	return 0;
+
+}
+
+int particleSystemGetSpread(lua_State *L) { // particlesystem:getSpread()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	lua_pushnumber(L, self->spread);
+
+	return 1;
+
+}
+
+int particleSystemSetSpeed(lua_State *L) { // particlesystem:setSpeed()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	self->speedMin = luaL_checknumber(L, 2);
+	self->speedMax = luaL_optnumber(L, 3, self->speedMin);
+
+	return 0;
+
+}
+
+int particleSystemGetSpeed(lua_State *L) { // particlesystem:getSpeed()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	lua_pushnumber(L, self->speedMin);
+	lua_pushnumber(L, self->speedMax);
+
+	return 2;
+
+}
+
+int particleSystemSetLinearAcceleration(lua_State *L) { // particlesystem:setLinearAcceleration()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	self->accelMin[0] = luaL_checknumber(L, 2);
+	self->accelMin[1] = luaL_checknumber(L, 3);
+	self->accelMax[0] = luaL_optnumber(L, 4, self->accelMin[0]);
+	self->accelMax[1] = luaL_optnumber(L, 5, self->accelMin[1]);
+
+	return 0;
+
+}
+
+int particleSystemGetLinearAcceleration(lua_State *L) { // particlesystem:getLinearAcceleration()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	lua_pushnumber(L, self->accelMin[0]);
+	lua_pushnumber(L, self->accelMin[1]);
+	lua_pushnumber(L, self->accelMax[0]);
+	lua_pushnumber(L, self->accelMax[1]);
+
+	return 4;
+
+}
+
+int particleSystemSetRotation(lua_State *L) { // particlesystem:setRotation()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	self->rotationMin = luaL_checknumber(L, 2);
+	self->rotationMax = luaL_optnumber(L, 3, self->rotationMin);
+
+	return 0;
+
+}
+
+int particleSystemGetRotation(lua_State *L) { // particlesystem:getRotation()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	lua_pushnumber(L, self->rotationMin);
+	lua_pushnumber(L, self->rotationMax);
+
+	return 2;
+
+}
+
+int particleSystemSetSpin(lua_State *L) { // particlesystem:setSpin()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	self->spinMin = luaL_checknumber(L, 2);
+	self->spinMax = luaL_optnumber(L, 3, self->spinMin);
+
+	return 0;
+
+}
+
+int particleSystemGetSpin(lua_State *L) { // particlesystem:getSpin()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	lua_pushnumber(L, self->spinMin);
+	lua_pushnumber(L, self->spinMax);
+
+	return 2;
+
+}
+
+int particleSystemSetSizes(lua_State *L) { // particlesystem:setSizes()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	int count = lua_gettop(L) - 1;
+
+	if (count < 1 || count > PARTICLE_MAX_SIZES) luaU_error(L, "At least one and at most 8 sizes can be used");
+
+	for (int i = 0; i < count; i++) self->sizes[i] = luaL_checknumber(L, i + 2);
+	self->sizeCount = count;
+
+	return 0;
+
+}
+
+int particleSystemGetSizes(lua_State *L) { // particlesystem:getSizes()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	for (int i = 0; i < self->sizeCount; i++) lua_pushnumber(L, self->sizes[i]);
+
+	return self->sizeCount;
+
+}
+
+int particleSystemSetColors(lua_State *L) { // particlesystem:setColors()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	int args = lua_gettop(L) - 1;
+
+	if (args < 4 || args % 4 != 0 || args / 4 > PARTICLE_MAX_COLORS) luaU_error(L, "Expected between one and 8 colors of r, g, b, a");
+
+	for (int i = 0; i < args; i++) self->colors[i / 4][i % 4] = luaL_checknumber(L, i + 2);
+	self->colorCount = args / 4;
+
+	return 0;
+
+}
+
+int particleSystemGetColors(lua_State *L) { // particlesystem:getColors()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	for (int i = 0; i < self->colorCount * 4; i++) lua_pushnumber(L, self->colors[i / 4][i % 4]);
+
+	return self->colorCount * 4;
+
+}
+
+int particleSystemSetOffset(lua_State *L) { // particlesystem:setOffset()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	self->ox = luaL_checknumber(L, 2);
+	self->oy = luaL_checknumber(L, 3);
+
+	return 0;
+
+}
+
+int particleSystemGetOffset(lua_State *L) { // particlesystem:getOffset()
+
+	love_particlesystem *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+	lua_pushnumber(L, self->ox);
+	lua_pushnumber(L, self->oy);
+
+	return 2;
+
+}
+
+int initParticleSystemClass(lua_State *L) {
+
+	luaL_Reg reg[] = {
+		{ "new",                   particleSystemNew                   },
+		{ "__gc",                  particleSystemGC                    },
+		{ "update",                particleSystemUpdate                },
+		{ "emit",                  particleSystemEmit                  },
+		{ "start",                 particleSystemStart                 },
+		{ "stop",                  particleSystemStop                  },
+		{ "pause",                 particleSystemPause                 },
+		{ "reset",                 particleSystemReset                 },
+		{ "isActive",              particleSystemIsActive              },
+		{ "isPaused",              particleSystemIsPaused              },
+		{ "isStopped",             particleSystemIsStopped             },
+		{ "getCount",              particleSystemGetCount              },
+		{ "setBufferSize",         particleSystemSetBufferSize         },
+		{ "getBufferSize",         particleSystemGetBufferSize         },
+		{ "setEmissionRate",       particleSystemSetEmissionRate       },
+		{ "getEmissionRate",       particleSystemGetEmissionRate       },
+		{ "setEmitterLifetime",    particleSystemSetEmitterLifetime    },
+		{ "getEmitterLifetime",    particleSystemGetEmitterLifetime    },
+		{ "setParticleLifetime",   particleSystemSetParticleLifetime   },
+		{ "getParticleLifetime",   particleSystemGetParticleLifetime   },
+		{ "setPosition",           particleSystemSetPosition           },
+		{ "getPosition",           particleSystemGetPosition           },
+		{ "setDirection",          particleSystemSetDirection          },
+		{ "getDirection",          particleSystemGetDirection          },
+		{ "setSpread",             particleSystemSetSpread             },
+		{ "getSpread",             particleSystemGetSpread             },
+		{ "setSpeed",              particleSystemSetSpeed              },
+		{ "getSpeed",              particleSystemGetSpeed              },
+		{ "setLinearAcceleration", particleSystemSetLinearAcceleration },
+		{ "getLinearAcceleration", particleSystemGetLinearAcceleration },
+		{ "setRotation",           particleSystemSetRotation           },
+		{ "getRotation",           particleSystemGetRotation           },
+		{ "setSpin",               particleSystemSetSpin               },
+		{ "getSpin",               particleSystemGetSpin               },
+		{ "setSizes",              particleSystemSetSizes              },
+		{ "getSizes",              particleSystemGetSizes              },
+		{ "setColors",             particleSystemSetColors             },
+		{ "getColors",             particleSystemGetColors             },
+		{ "setOffset",             particleSystemSetOffset             },
+		{ "getOffset",             particleSystemGetOffset             },
+		{ 0, 0 },
+	};
+
+	luaobj_newclass(L, CLASS_NAME, NULL, particleSystemNew, reg);
+
+	return 1;
+
+}
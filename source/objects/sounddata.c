@@ -0,0 +1,532 @@
+// This code is licensed under the MIT Open Source License.
+
+// Copyright (c) 2015 Ruairidh Carmichael - ruairidhcarmichael@live.co.uk
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "../shared.h"
+#include "../util.h"
+#include "../riff.h"
+
+#define SAMPLE_BUCKETS 32
+
+// Decoded samples currently in use, keyed by path. An entry lives for as
+// long as a Source or SoundData references it.
+love_sample *sampleCache[SAMPLE_BUCKETS];
+
+static u32 sampleHash(const char *path) {
+
+	u32 hash = 5381;
+
+	while (*path) hash = hash * 33 + (u8)*path++;
+
+	return hash % SAMPLE_BUCKETS;
+
+}
+
+// Fixed predictor pairs for the DSP's ADPCM, in 1/2048 units. Each frame
+// picks the pair that fits it best, so no per-sound coefficient search.
+static const s16 adpcmCoefs[8][2] = {
+	{    0,     0 },
+	{ 1920,     0 },
+	{ 3680, -1664 },
+	{ 3136, -1760 },
+	{ 3904, -1920 },
+	{ 1024,     0 },
+	{ 2048, -1024 },
+	{ 4032, -2016 },
+};
+
+static inline s16 clamp16(s32 x) {
+
+	return x > 32767 ? 32767 : (x < -32768 ? -32768 : x);
+
+}
+
+// Encodes one frame of up to 14 samples, returns the squared error.
+// Writes the 8 encoded bytes to out (if not NULL) and updates the history.
+static u64 adpcmEncodeFrame(const s16 *in, int count, int predictor, int shift, s32 *hist1, s32 *hist2, u8 *out) {
+
+	s32 c1 = adpcmCoefs[predictor][0];
+	s32 c2 = adpcmCoefs[predictor][1];
+	s32 h1 = *hist1, h2 = *hist2;
+	s32 step = 2048 << shift;
+	u64 error = 0;
+
+	if (out) {
+		memset(out, 0, 8);
+		out[0] = (predictor << 4) | shift;
+	}
+
+	for (int i = 0; i < 14; i++) {
+
+		s32 x = i < count ? in[i] : 0;
+		s32 pred = c1 * h1 + c2 * h2;
+		s32 diff = (x << 11) - pred - 1024;
+
+		s32 nibble = (diff >= 0 ? diff + step / 2 : diff - step / 2) / step;
+		if (nibble > 7) nibble = 7;
+		if (nibble < -8) nibble = -8;
+
+		s32 decoded = clamp16((((nibble << shift) << 11) + 1024 + pred) >> 11);
+
+		s64 d = decoded - x; // A bad trial predictor can miss by almost 65536
+		error += (u64)(d * d);
+		h2 = h1;
+		h1 = decoded;
+
+		if (out) out[1 + i / 2] |= (nibble & 0xF) << (i & 1 ? 0 : 4);
+
+	}
+
+	*hist1 = h1;
+	*hist2 = h2;
+
+	return error;
+
+}
+
+static void adpcmEncode(love_sample *self, const s16 *in, u32 count, u8 *out) {
+
+	s32 hist1 = 0, hist2 = 0;
+
+	for (u32 pos = 0; pos < count; pos += 14, out += 8) {
+
+		int frame = count - pos < 14 ? count - pos : 14;
+		u64 best = ~0ULL;
+		int bestPredictor = 0, bestShift = 0;
+
+		for (int predictor = 0; predictor < 8; predictor++) {
+
+			// Smallest shift that fits the largest residual, and the one above it
+			s32 h1 = hist1, h2 = hist2, peak = 0;
+			for (int i = 0; i < frame; i++) {
+				s32 residual = in[pos + i] - ((adpcmCoefs[predictor][0] * h1 + adpcmCoefs[predictor][1] * h2) >> 11);
+				if (abs(residual) > peak) peak = abs(residual);
+				h2 = h1;
+				h1 = in[pos + i];
+			}
+
+			int shift = 0;
+			while (shift < 12 && (7 << shift) < peak) shift++;
+
+			for (int s = shift; s <= shift + 1 && s <= 12; s++) {
+				s32 t1 = hist1, t2 = hist2;
+				u64 error = adpcmEncodeFrame(&in[pos], frame, predictor, s, &t1, &t2, NULL);
+				if (error < best) {
+					best = error;
+					bestPredictor = predictor;
+					bestShift = s;
+				}
+			}
+
+		}
+
+		adpcmEncodeFrame(&in[pos], frame, bestPredictor, bestShift, &hist1, &hist2, out);
+
+	}
+
+	for (int i = 0; i < 8; i++) {
+		self->adpcmCoefs[i * 2] = adpcmCoefs[i][0];
+		self->adpcmCoefs[i * 2 + 1] = adpcmCoefs[i][1];
+	}
+
+	self->adpcmData.index = self->data[0];
+	self->adpcmData.history0 = 0;
+	self->adpcmData.history1 = 0;
+
+}
+
+// Downmixes, resamples and re-encodes interleaved PCM16 into linear memory
+static const char *sampleConvert(love_sample *self, s16 *pcm, const love_sample_options *options) {
+
+	u32 channels = self->channels;
+	u32 count = self->nsamples;
+	s16 *converted = NULL; // Freed here, the caller owns the original buffer
+	const char *error = NULL;
+
+	if (options->channels == 1 && channels == 2) {
+		for (u32 i = 0; i < count; i++) pcm[i] = (pcm[i * 2] + pcm[i * 2 + 1]) / 2;
+		channels = 1;
+	}
+
+	if (options->rate && options->rate != (u32)self->rate) {
+
+		u32 newCount = (u64)count * options->rate / (u32)self->rate;
+		if (newCount == 0) newCount = 1;
+		u32 step = ((u64)(u32)self->rate << 16) / options->rate;
+		s16 *resampled = malloc(newCount * channels * sizeof(s16));
+
+		if (!resampled) return "not enough memory to resample";
+
+		converted = resampled;
+
+		// Linear interpolation
+		for (u32 i = 0; i < newCount; i++) {
+			u32 pos = ((u64)i * step) >> 16;
+			s32 frac = ((u64)i * step) & 0xFFFF;
+			u32 next = pos + 1 < count ? pos + 1 : pos;
+			for (u32 c = 0; c < channels; c++) {
+				s32 a = pcm[pos * channels + c];
+				s32 b = pcm[next * channels + c];
+				resampled[i * channels + c] = a + (((b - a) * (frac >> 1)) >> 15);
+			}
+		}
+
+		pcm = resampled;
+		count = newCount;
+		self->rate = options->rate;
+
+	}
+
+	int encoding = options->encoding == -1 ? NDSP_ENCODING_PCM16 : options->encoding;
+
+	u32 size;
+	if (encoding == NDSP_ENCODING_ADPCM) size = (count + 13) / 14 * 8;
+	else if (encoding == NDSP_ENCODING_PCM8) size = count * channels;
+	else size = count * channels * sizeof(s16);
+
+	// The DSP only decodes mono ADPCM
+	if (encoding == NDSP_ENCODING_ADPCM && channels != 1) error = "ADPCM needs mono sound, set mono = true";
+	else if (linearSpaceFree() < size) error = "not enough linear memory available";
+
+	if (!error) {
+		self->data = linearAlloc(size);
+		if (!self->data) error = "not enough linear memory available"; // Free space may be fragmented
+	}
+
+	if (error) {
+		free(converted);
+		return error;
+	}
+
+	self->size = size;
+	self->channels = channels;
+	self->nsamples = count;
+	self->encoding = encoding;
+
+	if (encoding == NDSP_ENCODING_ADPCM) {
+		adpcmEncode(self, pcm, count, (u8 *)self->data);
+	} else if (encoding == NDSP_ENCODING_PCM8) {
+		for (u32 i = 0; i < count * channels; i++) self->data[i] = clamp16(pcm[i] + 0x80) >> 8;
+	} else {
+		memcpy(self->data, pcm, size);
+	}
+
+	free(converted);
+
+	return NULL;
+
+}
+
+static const char *sampleLoadWav(love_sample *self, const char *filename, const love_sample_options *options) {
+
+	struct RiffReader reader;
+	struct WavInfo info;
+
+	const char *error = wavOpen(&reader, &info, filename);
+	if (error) return error;
+
+	u32 byte_per_sample = info.bitsPerSample / 8;
+
+	self->channels = info.channels;
+	self->rate = info.rate;
+	self->nsamples = info.dataSize / info.blockAlign;
+	self->size = self->nsamples * info.blockAlign;
+
+	if (self->nsamples == 0) {
+		riffClose(&reader);
+		return "WAV has no samples";
+	}
+	self->encoding = byte_per_sample == 1 ? NDSP_ENCODING_PCM8 : NDSP_ENCODING_PCM16;
+
+	bool convert = (options->rate && options->rate != info.rate) ||
+		(options->channels && options->channels != info.channels) ||
+		(options->encoding != -1 && options->encoding != self->encoding);
+
+	if (!convert) {
+
+		if (linearSpaceFree() >= self->size) self->data = linearAlloc(self->size);
+
+		if (!self->data) {
+			riffClose(&reader);
+			return "not enough linear memory available";
+		}
+
+		// Read data, a truncated file leaves silence at the end
+
+		u32 read = riffRead(&reader, self->data, self->size);
+		memset(self->data + read, self->encoding == NDSP_ENCODING_PCM8 ? 0x80 : 0, self->size - read);
+
+		// WAV 8-bit samples are unsigned, the DSP wants them signed
+		if (self->encoding == NDSP_ENCODING_PCM8) {
+			for (u32 i = 0; i < self->size; i++) self->data[i] ^= 0x80;
+		}
+
+	} else {
+
+		u32 count = self->nsamples * info.channels;
+		s16 *pcm = calloc(count, sizeof(s16));
+
+		if (!pcm) {
+			riffClose(&reader);
+			return "not enough memory to convert sound";
+		}
+
+		u32 read = riffRead(&reader, pcm, count * byte_per_sample);
+
+		// Widen 8-bit samples in place, back to front
+		if (self->encoding == NDSP_ENCODING_PCM8) {
+			u8 *bytes = (u8 *)pcm;
+			for (u32 i = count; i-- > 0;) pcm[i] = i < read ? (bytes[i] - 0x80) << 8 : 0;
+		}
+
+		error = sampleConvert(self, pcm, options);
+
+		free(pcm);
+
+		if (error != NULL) {
+			riffClose(&reader);
+			return error;
+		}
+
+	}
+
+	riffClose(&reader);
+
+	DSP_FlushDataCache((u32*)self->data, self->size);
+
+	return NULL;
+
+}
+
+// Reads conversion options from the table at idx, if there's one
+void sampleCheckOptions(lua_State *L, int idx, love_sample_options *options) {
+
+	options->rate = 0;
+	options->channels = 0;
+	options->encoding = -1;
+
+	if (!lua_istable(L, idx)) return;
+
+	// Presets first, explicit fields override them
+	lua_getfield(L, idx, "quality");
+	const char *quality = lua_tostring(L, -1);
+	if (quality) {
+		if (strcmp(quality, "medium") == 0) {
+			options->channels = 1;
+			options->encoding = NDSP_ENCODING_ADPCM;
+		} else if (strcmp(quality, "low") == 0) {
+			options->rate = 16364;
+			options->channels = 1;
+			options->encoding = NDSP_ENCODING_ADPCM;
+		} else if (strcmp(quality, "high") != 0) {
+			luaL_error(L, "Invalid quality '%s', expected 'high', 'medium' or 'low'", quality);
+		}
+	}
+	lua_pop(L, 1);
+
+	lua_getfield(L, idx, "rate");
+	if (!lua_isnil(L, -1)) options->rate = luaL_checkinteger(L, -1);
+	lua_pop(L, 1);
+
+	lua_getfield(L, idx, "mono");
+	if (!lua_isnil(L, -1)) options->channels = lua_toboolean(L, -1) ? 1 : 0;
+	lua_pop(L, 1);
+
+	lua_getfield(L, idx, "format");
+	const char *format = lua_tostring(L, -1);
+	if (format) {
+		if (strcmp(format, "pcm16") == 0) options->encoding = NDSP_ENCODING_PCM16;
+		else if (strcmp(format, "pcm8") == 0) options->encoding = NDSP_ENCODING_PCM8;
+		else if (strcmp(format, "adpcm") == 0) options->encoding = NDSP_ENCODING_ADPCM;
+		else luaL_error(L, "Invalid format '%s', expected 'pcm16', 'pcm8' or 'adpcm'", format);
+	}
+	lua_pop(L, 1);
+
+}
+
+love_sample *sampleAcquire(const char *filename, const love_sample_options *options, const char **error) {
+
+	u32 bucket = sampleHash(filename);
+
+	for (love_sample *sample = sampleCache[bucket]; sample; sample = sample->next) {
+		if (strcmp(sample->path, filename) == 0 && memcmp(&sample->options, options, sizeof(*options)) == 0) {
+			sample->refs++;
+			return sample;
+		}
+	}
+
+	if (!fileExists(filename)) {
+		*error = "Could not open source, file does not exist";
+		return NULL;
+	}
+
+	const char *ext = fileExtension(filename);
+
+	if (strncmp(ext, "wav", 3) != 0) {
+		*error = "Unknown audio type";
+		return NULL;
+	}
+
+	love_sample *sample = calloc(1, sizeof(*sample));
+
+	sample->type = TYPE_WAV;
+
+	*error = sampleLoadWav(sample, filename, options);
+
+	if (*error) {
+		free(sample);
+		return NULL;
+	}
+
+	sample->path = strdup(filename);
+	sample->options = *options;
+	sample->refs = 1;
+	sample->next = sampleCache[bucket];
+	sampleCache[bucket] = sample;
+
+	return sample;
+
+}
+
+void sampleRetain(love_sample *self) {
+
+	self->refs++;
+
+}
+
+void sampleRelease(love_sample *self) {
+
+	if (--self->refs > 0) return;
+
+	love_sample **link = &sampleCache[sampleHash(self->path)];
+	while (*link != self) link = &(*link)->next;
+	*link = self->next;
+
+	linearFree(self->data);
+	free(self->path);
+	free(self);
+
+}
+
+#define CLASS_TYPE  LUAOBJ_TYPE_SOUNDDATA
+#define CLASS_NAME  "SoundData"
+
+int soundDataNew(lua_State *L) { // love.sound.newSoundData()
+
+	const char *filename = luaL_checkstring(L, 1);
+
+	love_sample_options options;
+	sampleCheckOptions(L, 2, &options);
+
+	love_sounddata *self = luaobj_newudata(L, sizeof(*self));
+	luaobj_setclass(L, CLASS_TYPE, CLASS_NAME);
+
+	const char *error = NULL;
+	self->sample = sampleAcquire(filename, &options, &error);
+
+	if (error) luaU_error(L, error);
+
+	return 1;
+
+}
+
+int soundDataGC(lua_State *L) { // Garbage Collection
+
+	love_sounddata *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	if (self->sample) sampleRelease(self->sample);
+
+	return 0;
+
+}
+
+int soundDataGetSampleCount(lua_State *L) { // soundData:getSampleCount()
+
+	love_sounddata *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	lua_pushinteger(L, self->sample->nsamples);
+
+	return 1;
+
+}
+
+int soundDataGetSampleRate(lua_State *L) { // soundData:getSampleRate()
+
+	love_sounddata *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	lua_pushinteger(L, self->sample->rate);
+
+	return 1;
+
+}
+
+int soundDataGetChannels(lua_State *L) { // soundData:getChannels()
+
+	love_sounddata *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	lua_pushinteger(L, self->sample->channels);
+
+	return 1;
+
+}
+
+int soundDataGetBitDepth(lua_State *L) { // soundData:getBitDepth()
+
+	love_sounddata *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	int bits = 16;
+	if (self->sample->encoding == NDSP_ENCODING_PCM8) bits = 8;
+	else if (self->sample->encoding == NDSP_ENCODING_ADPCM) bits = 4;
+
+	lua_pushinteger(L, bits);
+
+	return 1;
+
+}
+
+int soundDataGetDuration(lua_State *L) { // soundData:getDuration()
+
+	love_sounddata *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	lua_pushnumber(L, (double)(self->sample->nsamples) / self->sample->rate);
+
+	return 1;
+
+}
+
+int initSoundDataClass(lua_State *L) {
+
+	luaL_Reg reg[] = {
+		{"new",				soundDataNew			},
+		{"__gc",			soundDataGC				},
+		{"getSampleCount",	soundDataGetSampleCount	},
+		{"getSampleRate",	soundDataGetSampleRate	},
+		{"getChannels",		soundDataGetChannels	},
+		{"getBitDepth",		soundDataGetBitDepth	},
+		{"getDuration",		soundDataGetDuration	},
+		{ 0, 0 },
+	};
+
+	luaobj_newclass(L, CLASS_NAME, NULL, soundDataNew, reg);
+
+	return 1;
+
+}
@@ -22,141 +22,329 @@
 
 #include "../shared.h"
 #include "../util.h"
+#include "../riff.h"
 
-bool channelList[24];
+#define VOICE_COUNT 24
 
-int getOpenChannel() {
+#define STREAM_BLOCKS 3
+#define STREAM_BLOCK_FRAMES 4096
 
-	for (int i = 0; i <= 23; i++) {
-		if (!channelList[i]) {
-			channelList[i] = true;
-			return i;
+// Sources only hold a hardware channel (voice) while they play.
+struct Voice {
+
+	love_source *source; // Owner, NULL when the channel is free
+	u32 started; // Play order, to find the oldest voice
+
+};
+
+struct Voice voices[VOICE_COUNT];
+int voiceCount = VOICE_COUNT; // One less once the mixing bus takes its channel
+u32 voiceClock = 0;
+u32 voiceSteals = 0;
+u32 voiceRejections = 0;
+
+// Streaming sources read the data chunk in fixed blocks, refilled by
+// sourceUpdateStreams once a frame.
+struct Stream {
+
+	char *filename;
+	struct RiffReader reader;
+	struct WavInfo info;
+
+	u8 *buffer; // STREAM_BLOCKS blocks, in linear memory
+	u32 blockSize;
+	ndspWaveBuf waveBufs[STREAM_BLOCKS];
+
+	u32 readPos; // Bytes of the data chunk read so far
+	u32 playedFrames; // Frames of the blocks that finished playing
+
+};
+
+static bool waveBufBusy(const ndspWaveBuf *waveBuf) {
+
+	return waveBuf->status == NDSP_WBUF_QUEUED || waveBuf->status == NDSP_WBUF_PLAYING;
+
+}
+
+bool voiceBusy(int channel) {
+
+	love_source *owner = voices[channel].source;
+
+	if (!owner) return false;
+
+	if (owner->stream) {
+		for (int i = 0; i < STREAM_BLOCKS; i++) {
+			if (waveBufBusy(&owner->stream->waveBufs[i])) return true;
 		}
+		return false;
 	}
 
-	return -1;
+	return waveBufBusy(&owner->waveBuf);
+
+}
+
+void voiceRelease(int channel) {
+
+	ndspChnWaveBufClear(channel);
+
+	if (voices[channel].source) voices[channel].source->audiochannel = -1;
+	voices[channel].source = NULL;
+
+}
+
+int voiceAcquire(love_source *self) {
+
+	if (self->audiochannel != -1) return self->audiochannel;
+
+	int channel = -1;
+
+	for (int i = 0; i < voiceCount; i++) {
+		if (!voiceBusy(i)) {
+			channel = i;
+			break;
+		}
+	}
+
+	if (channel == -1) {
+
+		// Every voice is busy: steal the lowest priority, then quietest, then oldest one
+		channel = 0;
+		for (int i = 1; i < voiceCount; i++) {
+			love_source *a = voices[i].source;
+			love_source *b = voices[channel].source;
+			if (a->priority != b->priority) {
+				if (a->priority < b->priority) channel = i;
+			} else if (a->mix[0] != b->mix[0]) {
+				if (a->mix[0] < b->mix[0]) channel = i;
+			} else if ((s32)(voices[i].started - voices[channel].started) < 0) {
+				channel = i;
+			}
+		}
+
+		if (voices[channel].source->priority > self->priority) {
+			voiceRejections++;
+			return -1;
+		}
+
+		voiceSteals++;
+
+	}
+
+	voiceRelease(channel);
+
+	voices[channel].source = self;
+	voices[channel].started = voiceClock++;
+	self->audiochannel = channel;
+
+	return channel;
+
+}
+
+void voiceStopAll() {
+
+	for (int i = 0; i < voiceCount; i++) voiceRelease(i);
+
+}
+
+int voiceActiveCount() {
+
+	int count = 0;
+
+	for (int i = 0; i < voiceCount; i++) {
+		if (voiceBusy(i)) count++;
+	}
+
+	return count;
 
 }
 
 #define CLASS_TYPE  LUAOBJ_TYPE_SOURCE
 #define CLASS_NAME  "Source"
 
-const char *sourceInit(love_source *self, const char *filename) {
+love_sample *sampleAcquire(const char *filename, const love_sample_options *options, const char **error);
+void sampleCheckOptions(lua_State *L, int idx, love_sample_options *options);
+void sampleRetain(love_sample *self);
+void sampleRelease(love_sample *self);
+
+int mixerPlay(love_sample *sample, float gainL, float gainR, bool loop, u32 *generation);
+bool mixerIsPlaying(int slot, u32 generation);
+void mixerStop(int slot, u32 generation);
+void mixerSetGain(int slot, u32 generation, float gainL, float gainR);
+u32 mixerTell(int slot, u32 generation);
+
+static const char *streamOpen(love_source *self, const char *filename) {
+
+	struct Stream *stream = calloc(1, sizeof(*stream));
+
+	const char *error = wavOpen(&stream->reader, &stream->info, filename);
+
+	if (error) {
+		free(stream);
+		return error;
+	}
+
+	stream->blockSize = STREAM_BLOCK_FRAMES * stream->info.blockAlign;
+	stream->buffer = linearAlloc(STREAM_BLOCKS * stream->blockSize);
+
+	if (!stream->buffer) {
+		riffClose(&stream->reader);
+		free(stream);
+		return "not enough linear memory available";
+	}
+
+	stream->filename = strdup(filename);
+	self->stream = stream;
+
+	return NULL;
+
+}
+
+static void streamClose(struct Stream *stream) {
+
+	riffClose(&stream->reader);
+	linearFree(stream->buffer);
+	free(stream->filename);
+	free(stream);
 
-	if (fileExists(filename)) {
+}
+
+// Reads the next block into waveBuf and queues it, wrapping around when looping
+static void streamFill(love_source *self, int channel, int block) {
 
-		for (int i=0; i<12; i++) self->mix[i] = 1.0f;
-		self->interp = NDSP_INTERP_LINEAR;
+	struct Stream *stream = self->stream;
+	ndspWaveBuf *waveBuf = &stream->waveBufs[block];
+	u8 *data = stream->buffer + block * stream->blockSize;
 
-		const char *ext = fileExtension(filename);
+	if (stream->readPos >= stream->info.dataSize && self->loop) {
+		riffSeek(&stream->reader, stream->info.dataOffset);
+		stream->readPos = 0;
+	}
 
-		if (strncmp(ext, "wav", 3) == 0) self->type = TYPE_WAV;
-		else self->type = TYPE_UNKNOWN;
+	u32 size = stream->info.dataSize - stream->readPos;
+	if (size > stream->blockSize) size = stream->blockSize;
 
-		if (self->type == TYPE_WAV) {
+	size = riffRead(&stream->reader, data, size);
+	stream->readPos += size;
 
-			FILE *file = fopen(filename, "rb");
+	u32 frames = size / stream->info.blockAlign;
+
+	if (frames == 0) { // End of the data, or a truncated file
+		stream->readPos = stream->info.dataSize;
+		return;
+	}
 
-			if (file) {
+	// WAV 8-bit samples are unsigned, the DSP wants them signed
+	if (stream->info.bitsPerSample == 8) {
+		for (u32 i = 0; i < size; i++) data[i] ^= 0x80;
+	}
 
-				const char *error = NULL;
-				u32 ckSize;
-				char buff[8];
+	DSP_FlushDataCache((u32*)data, size);
 
-				// Master chunk
-				fread(buff, 4, 1, file); // ckId
-				if (strncmp(buff, "RIFF", 4) != 0) error = "RIFF chunk not found";
+	memset(waveBuf, 0, sizeof(*waveBuf));
+	waveBuf->data_vaddr = data;
+	waveBuf->nsamples = frames;
 
-				fseek(file, 4, SEEK_CUR); // skip ckSize
+	ndspChnWaveBufAdd(channel, waveBuf);
 
-				fread(buff, 4, 1, file); // WAVEID
-				if (strncmp(buff, "WAVE", 4) != 0) error = "RIFF not in WAVE format";
-				// fmt Chunk
-				fread(buff, 4, 1, file); // ckId
-				if (strncmp(buff, "fmt ", 4) != 0) error = "fmt chunk not found";
+}
 
-				fread(buff, 4, 1, file); // ckSize
-				if (*buff != 16) error = "WAV not in PCM format (bad chunk size)"; // should be 16 for PCM format
+static void streamStart(love_source *self, int channel) {
 
-				fread(buff, 2, 1, file); // wFormatTag
-				if (*buff != 0x0001) error = "WAV not in PCM format"; // PCM format
+	struct Stream *stream = self->stream;
 
-				u16 channels;
-				fread(&channels, 2, 1, file); // nChannels
-				self->channels = channels;
-				
-				u32 rate;
-				fread(&rate, 4, 1, file); // nSamplesPerSec
-				self->rate = rate;
+	riffSeek(&stream->reader, stream->info.dataOffset);
+	stream->readPos = 0;
+	stream->playedFrames = 0;
 
-				fseek(file, 4, SEEK_CUR); // skip nAvgBytesPerSec
+	for (int i = 0; i < STREAM_BLOCKS; i++) {
+		memset(&stream->waveBufs[i], 0, sizeof(ndspWaveBuf));
+		streamFill(self, channel, i);
+	}
 
-				u16 byte_per_block; // 1 block = 1*channelCount samples
-				fread(&byte_per_block, 2, 1, file); // nBlockAlign
+}
 
-				u16 byte_per_sample;
-				fread(&byte_per_sample, 2, 1, file); // wBitsPerSample
-				byte_per_sample /= 8; // bits -> bytes
+void sourceUpdateStreams() {
 
-				// There may be some additionals chunks between fmt and data
-				fread(&buff, 4, 1, file); // ckId
-				while (strncmp(buff, "data", 4) != 0) {
-					fread(&ckSize, 4, 1, file); // ckSize
+	for (int channel = 0; channel < voiceCount; channel++) {
 
-					fseek(file, ckSize, SEEK_CUR); // skip chunk
+		love_source *owner = voices[channel].source;
+		if (!owner || !owner->stream) continue;
 
-					int i = fread(&buff, 1, 4, file); // next chunk ckId
+		for (int i = 0; i < STREAM_BLOCKS; i++) {
+			ndspWaveBuf *waveBuf = &owner->stream->waveBufs[i];
+			if (waveBuf->status == NDSP_WBUF_DONE) {
+				owner->stream->playedFrames += waveBuf->nsamples;
+				waveBuf->status = NDSP_WBUF_FREE;
+				streamFill(owner, channel, i);
+			}
+		}
 
-					if (i < 4) {
-						error = "reached EOF before finding a data chunk";
-						break;
-					}
-				}
+	}
 
-				// data Chunk (ckId already read)
-				fread(&ckSize, 4, 1, file); // ckSize
-				self->size = ckSize;
+}
 
-				self->nsamples = self->size / byte_per_block;
+static void sourceInitParams(love_source *self) {
 
-				if (byte_per_sample == 1) self->encoding = NDSP_ENCODING_PCM8;
-				else if (byte_per_sample == 2) self->encoding = NDSP_ENCODING_PCM16;
-				else return "unknown encoding, needs to be PCM8 or PCM16";
+	for (int i=0; i<12; i++) self->mix[i] = 1.0f;
+	self->interp = NDSP_INTERP_LINEAR;
 
-				if (error != NULL) {
-					fclose(file);
-					return error;
-				}
+	self->audiochannel = -1;
+	self->priority = 0;
+	self->loop = false;
 
-				self->audiochannel = getOpenChannel();
-				self->loop = false;
+	self->mixed = false;
+	self->mixvoice = -1;
 
-				// Read data
-				if (linearSpaceFree() < self->size) return "not enough linear memory available";
-				self->data = linearAlloc(self->size);
+	self->sample = NULL;
+	self->stream = NULL;
 
-				fread(self->data, self->size, 1, file);
+}
 
-			} else return "Could not open source, read failure";
+const char *sourceInit(love_source *self, const char *filename, bool stream, const love_sample_options *options) {
 
-			fclose(file);
+	sourceInitParams(self);
 
-		} else return "Unknown audio type";
+	if (stream) return streamOpen(self, filename);
 
-	} else return "Could not open source, file does not exist";
+	const char *error = NULL;
+	self->sample = sampleAcquire(filename, options, &error);
 
-	return NULL;
+	return error;
 
 }
 
 int sourceNew(lua_State *L) { // love.audio.newSource()
 
+	if (lua_isuserdata(L, 1)) {
+
+		love_sounddata *soundData = luaobj_checkudata(L, 1, LUAOBJ_TYPE_SOUNDDATA);
+
+		love_source *self = luaobj_newudata(L, sizeof(*self));
+		luaobj_setclass(L, CLASS_TYPE, CLASS_NAME);
+
+		sourceInitParams(self);
+		self->sample = soundData->sample;
+		sampleRetain(self->sample);
+
+		return 1;
+
+	}
+
 	const char *filename = luaL_checkstring(L, 1);
 
+	// newSource(filename, [type,] options)
+	const char *type = lua_isstring(L, 2) ? lua_tostring(L, 2) : "static";
+	bool stream = strcmp(type, "stream") == 0;
+
+	if (!stream && strcmp(type, "static") != 0) luaL_error(L, "Invalid source type '%s', expected 'static' or 'stream'", type);
+
+	love_sample_options options;
+	sampleCheckOptions(L, lua_istable(L, 2) ? 2 : 3, &options);
+
 	love_source *self = luaobj_newudata(L, sizeof(*self));
 	luaobj_setclass(L, CLASS_TYPE, CLASS_NAME);
 
-	const char *error = sourceInit(self, filename);
+	const char *error = sourceInit(self, filename, stream, &options);
 
 	if (error) luaU_error(L, error);
 
@@ -164,17 +352,41 @@ int sourceNew(lua_State *L) { // love.audio.newSource()
 
 }
 
+int sourceClone(lua_State *L) { // source:clone()
+
+	love_source *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	love_source *clone = luaobj_newudata(L, sizeof(*clone));
+	luaobj_setclass(L, CLASS_TYPE, CLASS_NAME);
+
+	*clone = *self;
+	clone->audiochannel = -1;
+	clone->mixvoice = -1;
+	memset(&clone->waveBuf, 0, sizeof(clone->waveBuf));
+
+	if (self->stream) { // Streams each need their own file and buffers
+		clone->stream = NULL;
+		const char *error = streamOpen(clone, self->stream->filename);
+		if (error) luaU_error(L, error);
+	} else {
+		sampleRetain(clone->sample);
+	}
+
+	return 1;
+
+}
+
 int sourceGC(lua_State *L) { // Garbage Collection
 
 	if (!soundEnabled) luaU_error(L, "Could not initialize audio");
 
 	love_source *self = luaobj_checkudata(L, 1, CLASS_TYPE);
 
-	ndspChnWaveBufClear(self->audiochannel);
-
-	linearFree(self->data);
+	if (self->audiochannel != -1) voiceRelease(self->audiochannel);
+	mixerStop(self->mixvoice, self->mixgen);
 
-	channelList[self->audiochannel] = false;
+	if (self->sample) sampleRelease(self->sample);
+	if (self->stream) streamClose(self->stream);
 
 	return 0;
 
@@ -186,30 +398,73 @@ int sourcePlay(lua_State *L) { // source:play()
 
 	love_source *self = luaobj_checkudata(L, 1, CLASS_TYPE);
 
-	if (self->audiochannel == -1) {
-		luaU_error(L, "No available audio channel");
-		return 0;
+	if (self->sample && self->sample->nsamples == 0) { // Nothing to play
+		lua_pushboolean(L, false);
+		return 1;
 	}
 
-	ndspChnWaveBufClear(self->audiochannel);
-	ndspChnReset(self->audiochannel);
-	ndspChnInitParams(self->audiochannel);
-	ndspChnSetMix(self->audiochannel, self->mix);
-	ndspChnSetInterp(self->audiochannel, self->interp);
-	ndspChnSetRate(self->audiochannel, self->rate);
-	ndspChnSetFormat(self->audiochannel, NDSP_CHANNELS(self->channels) | NDSP_ENCODING(self->encoding));
+	if (self->mixed && self->sample) {
 
-	ndspWaveBuf* waveBuf = calloc(1, sizeof(ndspWaveBuf));
+		mixerStop(self->mixvoice, self->mixgen);
 
-	waveBuf->data_vaddr = self->data;
-	waveBuf->nsamples = self->nsamples;
-	waveBuf->looping = self->loop;
+		self->mixvoice = mixerPlay(self->sample, self->mix[0], self->mix[1], self->loop, &self->mixgen);
 
-	DSP_FlushDataCache((u32*)self->data, self->size);
+		if (self->mixvoice != -1) {
+			lua_pushboolean(L, true);
+			return 1;
+		}
 
-	ndspChnWaveBufAdd(self->audiochannel, waveBuf);
+		// Bus full or not PCM16: fall back to a hardware voice
 
-	return 0;
+	}
+
+	int channel = voiceAcquire(self);
+
+	if (channel == -1) { // Every voice is busy with something more important
+		lua_pushboolean(L, false);
+		return 1;
+	}
+
+	ndspChnWaveBufClear(channel);
+	ndspChnReset(channel);
+	ndspChnInitParams(channel);
+	ndspChnSetMix(channel, self->mix);
+	ndspChnSetInterp(channel, self->interp);
+
+	if (self->stream) {
+
+		struct WavInfo *info = &self->stream->info;
+
+		ndspChnSetRate(channel, info->rate);
+		ndspChnSetFormat(channel, NDSP_CHANNELS(info->channels) | NDSP_ENCODING(info->bitsPerSample == 8 ? NDSP_ENCODING_PCM8 : NDSP_ENCODING_PCM16));
+
+		streamStart(self, channel);
+
+		lua_pushboolean(L, true);
+		return 1;
+
+	}
+
+	ndspChnSetRate(channel, self->sample->rate);
+	ndspChnSetFormat(channel, NDSP_CHANNELS(self->sample->channels) | NDSP_ENCODING(self->sample->encoding));
+
+	memset(&self->waveBuf, 0, sizeof(self->waveBuf));
+
+	if (self->sample->encoding == NDSP_ENCODING_ADPCM) {
+		ndspChnSetAdpcmCoefs(channel, self->sample->adpcmCoefs);
+		self->adpcmData = self->sample->adpcmData;
+		self->waveBuf.adpcm_data = &self->adpcmData;
+	}
+
+	self->waveBuf.data_vaddr = self->sample->data;
+	self->waveBuf.nsamples = self->sample->nsamples;
+	self->waveBuf.looping = self->loop;
+
+	ndspChnWaveBufAdd(channel, &self->waveBuf);
+
+	lua_pushboolean(L, true);
+
+	return 1;
 
 }
 
@@ -219,7 +474,8 @@ int sourceStop(lua_State *L) { // source:stop()
 
 	love_source *self = luaobj_checkudata(L, 1, CLASS_TYPE);
 
-	ndspChnWaveBufClear(self->audiochannel);
+	if (self->audiochannel != -1) voiceRelease(self->audiochannel);
+	mixerStop(self->mixvoice, self->mixgen);
 
 	return 0;
 
@@ -231,7 +487,7 @@ int sourceIsPlaying(lua_State *L) { // source:isPlaying()
 
 	love_source *self = luaobj_checkudata(L, 1, CLASS_TYPE);
 
-	lua_pushboolean(L, ndspChnIsPlaying(self->audiochannel));
+	lua_pushboolean(L, (self->audiochannel != -1 && voiceBusy(self->audiochannel)) || mixerIsPlaying(self->mixvoice, self->mixgen));
 
 	return 1;
 
@@ -272,7 +528,8 @@ int sourceSetVolume(lua_State *L) { // source:setVolume()
 
 	for (int i=0; i<=3; i++) self->mix[i] = vol;
 
-	ndspChnSetMix(self->audiochannel, self->mix);
+	if (self->audiochannel != -1) ndspChnSetMix(self->audiochannel, self->mix);
+	mixerSetGain(self->mixvoice, self->mixgen, self->mix[0], self->mix[1]);
 
 	return 0;
 
@@ -296,10 +553,16 @@ int sourceTell(lua_State *L) { // source:tell()
 
 	love_source *self = luaobj_checkudata(L, 1, CLASS_TYPE);
 
-	if (!ndspChnIsPlaying(self->audiochannel)) {
+	if (mixerIsPlaying(self->mixvoice, self->mixgen)) {
+		lua_pushnumber(L, (double)(mixerTell(self->mixvoice, self->mixgen)) / self->sample->rate);
+	} else if (self->audiochannel == -1 || !ndspChnIsPlaying(self->audiochannel)) {
 		lua_pushnumber(L, 0);
+	} else if (self->stream) {
+		struct WavInfo *info = &self->stream->info;
+		u32 frames = self->stream->playedFrames + ndspChnGetSamplePos(self->audiochannel);
+		lua_pushnumber(L, (double)(frames % (info->dataSize / info->blockAlign)) / info->rate);
 	} else {
-		lua_pushnumber(L, (double)(ndspChnGetSamplePos(self->audiochannel)) / self->rate);
+		lua_pushnumber(L, (double)(ndspChnGetSamplePos(self->audiochannel)) / self->sample->rate);
 	}
 
 	return 1;
@@ -312,7 +575,52 @@ int sourceGetDuration(lua_State *L) { // source:getDuration()
 
 	love_source *self = luaobj_checkudata(L, 1, CLASS_TYPE);
 
-	lua_pushnumber(L, (double)(self->nsamples) / self->rate);
+	if (self->stream) {
+		struct WavInfo *info = &self->stream->info;
+		lua_pushnumber(L, (double)(info->dataSize / info->blockAlign) / info->rate);
+	} else {
+		lua_pushnumber(L, (double)(self->sample->nsamples) / self->sample->rate);
+	}
+
+	return 1;
+
+}
+
+int sourceSetPriority(lua_State *L) { // source:setPriority()
+
+	love_source *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	self->priority = luaL_checkinteger(L, 2);
+
+	return 0;
+
+}
+
+int sourceGetPriority(lua_State *L) { // source:getPriority()
+
+	love_source *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	lua_pushinteger(L, self->priority);
+
+	return 1;
+
+}
+
+int sourceSetMixed(lua_State *L) { // source:setMixed()
+
+	love_source *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	self->mixed = lua_toboolean(L, 2);
+
+	return 0;
+
+}
+
+int sourceIsMixed(lua_State *L) { // source:isMixed()
+
+	love_source *self = luaobj_checkudata(L, 1, CLASS_TYPE);
+
+	lua_pushboolean(L, self->mixed);
 
 	return 1;
 
@@ -324,6 +632,7 @@ int initSourceClass(lua_State *L) {
 		{"new",			sourceNew	},
 		{"__gc",		sourceGC	},
 		{"play",		sourcePlay	},
+		{"clone",		sourceClone	},
 		{"stop",		sourceStop	},
 		{"isPlaying",	sourceIsPlaying},
 		{"setLooping",	sourceSetLooping},
@@ -332,6 +641,10 @@ int initSourceClass(lua_State *L) {
 		{"getVolume",	sourceGetVolume},
 		{"tell",		sourceTell},
 		{"getDuration", sourceGetDuration},
+		{"setPriority", sourceSetPriority},
+		{"getPriority", sourceGetPriority},
+		{"setMixed",	sourceSetMixed},
+		{"isMixed",		sourceIsMixed},
 		{ 0, 0 },
 	};
 
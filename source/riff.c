@@ -0,0 +1,248 @@
+// This code is licensed under the MIT Open Source License.
+
+// Copyright (c) 2015 Ruairidh Carmichael - ruairidhcarmichael@live.co.uk
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <string.h>
+
+#include "riff.h"
+
+#define WAVE_FORMAT_PCM 0x0001
+#define WAVE_FORMAT_EXTENSIBLE 0xFFFE
+
+static u16 readLE16(const u8 *p) {
+
+	return p[0] | (p[1] << 8);
+
+}
+
+static u32 readLE32(const u8 *p) {
+
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((u32)p[3] << 24);
+
+}
+
+u32 riffTell(struct RiffReader *reader) {
+
+	return reader->offset - (reader->bufferLen - reader->bufferPos);
+
+}
+
+u32 riffRead(struct RiffReader *reader, void *dst, u32 size) {
+
+	u8 *out = dst;
+	u32 done = 0;
+
+	// Never read past the end of the form
+	u32 left = reader->end > riffTell(reader) ? reader->end - riffTell(reader) : 0;
+	if (size > left) size = left;
+
+	while (done < size) {
+
+		u32 buffered = reader->bufferLen - reader->bufferPos;
+
+		if (buffered > 0) {
+
+			u32 n = size - done < buffered ? size - done : buffered;
+			memcpy(out + done, reader->buffer + reader->bufferPos, n);
+			reader->bufferPos += n;
+			done += n;
+
+		} else if (size - done >= RIFF_BUFFER_SIZE) {
+
+			// Big reads skip the buffer
+			reader->bufferPos = reader->bufferLen = 0;
+			u32 n = fread(out + done, 1, size - done, reader->file);
+			reader->offset += n;
+			done += n;
+			if (n == 0) break;
+
+		} else {
+
+			reader->bufferPos = 0;
+			reader->bufferLen = fread(reader->buffer, 1, RIFF_BUFFER_SIZE, reader->file);
+			reader->offset += reader->bufferLen;
+			if (reader->bufferLen == 0) break;
+
+		}
+
+	}
+
+	return done;
+
+}
+
+bool riffSeek(struct RiffReader *reader, u32 offset) {
+
+	u32 bufferStart = reader->offset - reader->bufferLen;
+
+	// Seeks within the buffer are free
+	if (offset >= bufferStart && offset <= reader->offset) {
+		reader->bufferPos = offset - bufferStart;
+		return true;
+	}
+
+	if (fseek(reader->file, offset, SEEK_SET) != 0) return false;
+
+	reader->offset = offset;
+	reader->bufferPos = reader->bufferLen = 0;
+
+	return true;
+
+}
+
+const char *riffOpen(struct RiffReader *reader, const char *filename, const char *form) {
+
+	reader->file = fopen(filename, "rb");
+	if (!reader->file) return "Could not open source, read failure";
+
+	reader->bufferPos = reader->bufferLen = 0;
+	reader->offset = 0;
+	reader->end = 12;
+
+	u8 header[12];
+
+	if (riffRead(reader, header, 12) != 12 || memcmp(header, "RIFF", 4) != 0) {
+		riffClose(reader);
+		return "RIFF chunk not found";
+	}
+
+	if (memcmp(header + 8, form, 4) != 0) {
+		riffClose(reader);
+		return "RIFF not in WAVE format";
+	}
+
+	// Reads stop at the end of the form, or earlier if the file is truncated
+	u32 size = readLE32(header + 4);
+	reader->end = size > 0xFFFFFFFF - 8 ? 0xFFFFFFFF : 8 + size;
+
+	return NULL;
+
+}
+
+void riffClose(struct RiffReader *reader) {
+
+	if (reader->file) fclose(reader->file);
+	reader->file = NULL;
+
+}
+
+bool riffNextChunk(struct RiffReader *reader, char id[4], u32 *size) {
+
+	u8 header[8];
+
+	if (riffRead(reader, header, 8) != 8) return false;
+
+	memcpy(id, header, 4);
+	*size = readLE32(header + 4);
+
+	return true;
+
+}
+
+// Skips to the next chunk, chunks are padded to an even size
+static bool riffSkipChunk(struct RiffReader *reader, u32 start, u32 size) {
+
+	u32 next = start + size + (size & 1);
+
+	if (next < start || next > reader->end) return false;
+
+	return riffSeek(reader, next);
+
+}
+
+const char *wavOpen(struct RiffReader *reader, struct WavInfo *info, const char *filename) {
+
+	memset(info, 0, sizeof(*info));
+
+	const char *error = riffOpen(reader, filename, "WAVE");
+	if (error) return error;
+
+	bool haveFormat = false;
+	char id[4];
+	u32 size;
+
+	while (riffNextChunk(reader, id, &size)) {
+
+		u32 start = riffTell(reader);
+
+		if (memcmp(id, "fmt ", 4) == 0) {
+
+			u8 fmt[40];
+			u32 n = size < sizeof(fmt) ? size : sizeof(fmt);
+
+			if (n < 16 || riffRead(reader, fmt, n) != n) {
+				error = "fmt chunk is truncated";
+				break;
+			}
+
+			info->format = readLE16(fmt);
+			info->channels = readLE16(fmt + 2);
+			info->rate = readLE32(fmt + 4);
+			info->blockAlign = readLE16(fmt + 12);
+			info->bitsPerSample = readLE16(fmt + 14);
+
+			// WAVE_FORMAT_EXTENSIBLE keeps the real format in its sub-format GUID
+			if (info->format == WAVE_FORMAT_EXTENSIBLE && n >= 26) info->format = readLE16(fmt + 24);
+
+			haveFormat = true;
+
+		} else if (memcmp(id, "data", 4) == 0) {
+
+			if (!haveFormat) {
+				error = "fmt chunk not found";
+				break;
+			}
+
+			info->dataOffset = start;
+			info->dataSize = size;
+
+			// Truncated files keep whatever data they have
+			if (info->dataSize > reader->end - start) info->dataSize = reader->end - start;
+
+			break;
+
+		}
+
+		if (!riffSkipChunk(reader, start, size)) {
+			error = "reached EOF before finding a data chunk";
+			break;
+		}
+
+	}
+
+	if (!error && !info->dataOffset) error = "reached EOF before finding a data chunk";
+
+	if (!error) {
+		if (info->format != WAVE_FORMAT_PCM) error = "WAV not in PCM format";
+		else if (info->channels < 1 || info->channels > 2) error = "WAV needs to be mono or stereo";
+		else if (info->bitsPerSample != 8 && info->bitsPerSample != 16) error = "unknown encoding, needs to be PCM8 or PCM16";
+		else if (info->rate == 0) error = "WAV has no sample rate";
+		else if (info->blockAlign != info->channels * info->bitsPerSample / 8) error = "WAV has a bad block alignment";
+	}
+
+	if (error) {
+		riffClose(reader);
+		return error;
+	}
+
+	return NULL;
+
+}
@@ -0,0 +1,65 @@
+// This code is licensed under the MIT Open Source License.
+
+// Copyright (c) 2015 Ruairidh Carmichael - ruairidhcarmichael@live.co.uk
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef RIFF_H_INCLUDED
+#define RIFF_H_INCLUDED
+
+#include <stdio.h>
+#include <3ds.h>
+
+#define RIFF_BUFFER_SIZE 2048
+
+// Buffered reader for RIFF files: small header reads are served from
+// the buffer, large reads go straight to the destination.
+struct RiffReader {
+
+	FILE *file;
+	u8 buffer[RIFF_BUFFER_SIZE];
+	u32 bufferPos, bufferLen;
+	u32 offset; // File offset of the next unbuffered byte
+	u32 end; // File offset where the RIFF form ends
+
+};
+
+struct WavInfo {
+
+	u16 format;
+	u16 channels;
+	u32 rate;
+	u16 blockAlign;
+	u16 bitsPerSample;
+
+	u32 dataOffset; // File offset of the sample data
+	u32 dataSize;
+
+};
+
+const char *riffOpen(struct RiffReader *reader, const char *filename, const char *form);
+void riffClose(struct RiffReader *reader);
+u32 riffRead(struct RiffReader *reader, void *dst, u32 size);
+bool riffSeek(struct RiffReader *reader, u32 offset);
+u32 riffTell(struct RiffReader *reader);
+bool riffNextChunk(struct RiffReader *reader, char id[4], u32 *size);
+
+const char *wavOpen(struct RiffReader *reader, struct WavInfo *info, const char *filename);
+
+#endif
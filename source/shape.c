@@ -0,0 +1,366 @@
+// This code is licensed under the MIT Open Source License.
+
+// Copyright (c) 2015 Ruairidh Carmichael - ruairidhcarmichael@live.co.uk
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "shape.h"
+
+#define SHAPE_TOLERANCE 0.5f // Furthest a segment may stray from the curve, in pixels
+#define SHAPE_SCRATCH_SLOTS 2
+
+// Unit circle points per segment count, built the first time a count is used
+static float *unitCircles[SHAPE_MAX_SEGMENTS + 1];
+
+static float *scratch[SHAPE_SCRATCH_SLOTS];
+static int scratchSize[SHAPE_SCRATCH_SLOTS];
+
+int shapeSegments(float radius) {
+
+	// Fewest segments whose chords stay within SHAPE_TOLERANCE of the circle,
+	// rounded up to a multiple of 4 so only a few unit circles get cached
+
+	if (radius <= SHAPE_TOLERANCE) return SHAPE_MIN_SEGMENTS;
+
+	int segments = ceilf(M_PI / acosf(1 - SHAPE_TOLERANCE / radius));
+	segments = (segments + 3) & ~3;
+
+	if (segments < SHAPE_MIN_SEGMENTS) return SHAPE_MIN_SEGMENTS;
+	if (segments > SHAPE_MAX_SEGMENTS) return SHAPE_MAX_SEGMENTS;
+
+	return segments;
+
+}
+
+const float *shapeUnitCircle(int segments) {
+
+	if (segments < 3) segments = 3;
+	if (segments > SHAPE_MAX_SEGMENTS) segments = SHAPE_MAX_SEGMENTS;
+
+	if (!unitCircles[segments]) {
+
+		float *points = malloc(segments * 2 * sizeof(float));
+		if (!points) return NULL;
+
+		for (int i = 0; i < segments; i++) {
+			float angle = 2 * M_PI * i / segments;
+			points[i * 2 + 0] = cosf(angle);
+			points[i * 2 + 1] = sinf(angle);
+		}
+
+		unitCircles[segments] = points;
+
+	}
+
+	return unitCircles[segments];
+
+}
+
+void shapeEllipse(float *out, float x, float y, float rx, float ry, int segments) {
+
+	const float *unit = shapeUnitCircle(segments);
+
+	if (!unit) {
+		memset(out, 0, segments * 2 * sizeof(float));
+		return;
+	}
+
+	for (int i = 0; i < segments; i++) {
+		out[i * 2 + 0] = x + rx * unit[i * 2 + 0];
+		out[i * 2 + 1] = y + ry * unit[i * 2 + 1];
+	}
+
+}
+
+int shapeArc(float *out, float x, float y, float radius, float angle1, float angle2, int segments) {
+
+	// segments + 1 points from angle1 to angle2, rotated step by step
+
+	float step = (angle2 - angle1) / segments;
+	float c = cosf(step), s = sinf(step);
+
+	float dx = radius * cosf(angle1);
+	float dy = radius * sinf(angle1);
+
+	for (int i = 0; i <= segments; i++) {
+
+		out[i * 2 + 0] = x + dx;
+		out[i * 2 + 1] = y + dy;
+
+		float t = dx;
+		dx = c * dx - s * dy;
+		dy = s * t + c * dy;
+
+	}
+
+	return segments + 1;
+
+}
+
+static float cross(const float *a, const float *b, const float *c) {
+
+	return (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+
+}
+
+bool shapeConvex(const float *points, int count) {
+
+	int sign = 0;
+
+	for (int i = 0; i < count; i++) {
+
+		float turn = cross(&points[i * 2], &points[((i + 1) % count) * 2], &points[((i + 2) % count) * 2]);
+
+		if (turn == 0) continue;
+		if (sign == 0) sign = turn > 0 ? 1 : -1;
+		else if ((turn > 0 ? 1 : -1) != sign) return false;
+
+	}
+
+	return true;
+
+}
+
+static bool inTriangle(const float *p, const float *a, const float *b, const float *c, float winding) {
+
+	return cross(a, b, p) * winding >= 0 && cross(b, c, p) * winding >= 0 && cross(c, a, p) * winding >= 0;
+
+}
+
+int shapeTriangulate(const float *points, int count, float *out) {
+
+	// Ear clipping. Writes 3 * (count - 2) points as separate triangles and
+	// returns how many points were written.
+
+	if (count < 3) return 0;
+
+	int *remaining = malloc(count * sizeof(int));
+	if (!remaining) return 0;
+
+	float area = 0;
+	for (int i = 0; i < count; i++) {
+		int j = (i + 1) % count;
+		area += points[i * 2] * points[j * 2 + 1] - points[j * 2] * points[i * 2 + 1];
+	}
+
+	float winding = area < 0 ? -1 : 1;
+
+	for (int i = 0; i < count; i++) remaining[i] = i;
+
+	int n = count, written = 0, misses = 0, i = 0;
+
+	while (n > 3) {
+
+		int prev = remaining[(i + n - 1) % n];
+		int curr = remaining[i % n];
+		int next = remaining[(i + 1) % n];
+
+		const float *a = &points[prev * 2], *b = &points[curr * 2], *c = &points[next * 2];
+
+		bool ear = cross(a, b, c) * winding > 0;
+
+		for (int k = 0; ear && k < n; k++) {
+			int v = remaining[k];
+			if (v != prev && v != curr && v != next && inTriangle(&points[v * 2], a, b, c, winding)) ear = false;
+		}
+
+		// A full lap without an ear means the polygon self-intersects, clip anyway
+		if (ear || misses > n) {
+
+			memcpy(&out[written * 2], a, 2 * sizeof(float));
+			memcpy(&out[written * 2 + 2], b, 2 * sizeof(float));
+			memcpy(&out[written * 2 + 4], c, 2 * sizeof(float));
+			written += 3;
+
+			memmove(&remaining[i % n], &remaining[i % n + 1], (n - i % n - 1) * sizeof(int));
+			n--;
+			misses = 0;
+
+		} else {
+
+			i++;
+			misses++;
+
+		}
+
+		i %= n;
+
+	}
+
+	for (int k = 0; k < 3; k++) memcpy(&out[(written + k) * 2], &points[remaining[k] * 2], 2 * sizeof(float));
+	written += 3;
+
+	free(remaining);
+
+	return written;
+
+}
+
+static void edgeNormal(const float *a, const float *b, float *normal) {
+
+	float dx = b[0] - a[0], dy = b[1] - a[1];
+	float length = sqrtf(dx * dx + dy * dy);
+
+	if (length > 0) {
+		normal[0] = -dy / length;
+		normal[1] = dx / length;
+	} else {
+		normal[0] = normal[1] = 0;
+	}
+
+}
+
+static int strokePair(float *out, int written, float x0, float y0, float x1, float y1) {
+
+	out[written * 2 + 0] = x0;
+	out[written * 2 + 1] = y0;
+	out[written * 2 + 2] = x1;
+	out[written * 2 + 3] = y1;
+
+	return written + 2;
+
+}
+
+static int strokeSegments(const float *points, int count, bool closed, float half, float *out) {
+
+	// Separate quads joined by degenerate triangles, so it's still one strip
+
+	int segments = closed ? count : count - 1;
+	int written = 0;
+
+	for (int i = 0; i < segments; i++) {
+
+		const float *a = &points[i * 2], *b = &points[((i + 1) % count) * 2];
+		float n[2];
+
+		edgeNormal(a, b, n);
+
+		int first = written;
+
+		written = strokePair(out, written, a[0] + n[0] * half, a[1] + n[1] * half, a[0] - n[0] * half, a[1] - n[1] * half);
+		written = strokePair(out, written, b[0] + n[0] * half, b[1] + n[1] * half, b[0] - n[0] * half, b[1] - n[1] * half);
+
+		if (i > 0) {
+			// Repeat the previous quad's last point and this quad's first one
+			memmove(&out[(first + 2) * 2], &out[first * 2], 8 * sizeof(float));
+			memcpy(&out[first * 2], &out[(first - 1) * 2], 2 * sizeof(float));
+			memcpy(&out[(first + 1) * 2], &out[(first + 2) * 2], 2 * sizeof(float));
+			written += 2;
+		}
+
+	}
+
+	return written;
+
+}
+
+int shapeStroke(const float *points, int count, bool closed, float width, ShapeJoin join, float *out) {
+
+	// Triangle strip around the line, at most SHAPE_STROKE_POINTS(count)
+	// points. Returns the point count.
+
+	if (count < 2) return 0;
+
+	float half = width / 2;
+
+	if (join == SHAPE_JOIN_NONE) return strokeSegments(points, count, closed, half, out);
+
+	int written = 0;
+
+	for (int i = 0; i < count; i++) {
+
+		const float *p = &points[i * 2];
+		float before[2] = { 0, 0 }, after[2] = { 0, 0 };
+
+		if (i > 0 || closed) edgeNormal(&points[((i + count - 1) % count) * 2], p, before);
+		if (i < count - 1 || closed) edgeNormal(p, &points[((i + 1) % count) * 2], after);
+
+		if (before[0] == 0 && before[1] == 0) memcpy(before, after, sizeof(before));
+		if (after[0] == 0 && after[1] == 0) memcpy(after, before, sizeof(after));
+
+		float mx = before[0] + after[0], my = before[1] + after[1];
+		float length = sqrtf(mx * mx + my * my);
+
+		if (length == 0) {
+			// Doubles back on itself
+			written = strokePair(out, written, p[0] + after[0] * half, p[1] + after[1] * half, p[0] - after[0] * half, p[1] - after[1] * half);
+			continue;
+		}
+
+		mx /= length;
+		my /= length;
+
+		float cosine = mx * after[0] + my * after[1];
+
+		if (cosine > 1.0f / SHAPE_MITER_LIMIT && (join == SHAPE_JOIN_MITER || cosine > 0.9999f)) {
+			float offset = half / cosine;
+			written = strokePair(out, written, p[0] + mx * offset, p[1] + my * offset, p[0] - mx * offset, p[1] - my * offset);
+			continue;
+		}
+
+		// Bevel: the inner side meets at the miter point, clamped for sharp
+		// turns, and the outer side cuts across between the two edges
+		float offset = cosine > 1.0f / SHAPE_MITER_LIMIT ? half / cosine : half * SHAPE_MITER_LIMIT;
+
+		// The outer side is the one the next edge turns away from
+		const float *next = &points[((i + 1) % count) * 2];
+		bool outerPlus = (next[0] - p[0]) * before[0] + (next[1] - p[1]) * before[1] < 0;
+
+		if (outerPlus) {
+			float ix = p[0] - mx * offset, iy = p[1] - my * offset;
+			written = strokePair(out, written, p[0] + before[0] * half, p[1] + before[1] * half, ix, iy);
+			written = strokePair(out, written, p[0] + after[0] * half, p[1] + after[1] * half, ix, iy);
+		} else {
+			float ix = p[0] + mx * offset, iy = p[1] + my * offset;
+			written = strokePair(out, written, ix, iy, p[0] - before[0] * half, p[1] - before[1] * half);
+			written = strokePair(out, written, ix, iy, p[0] - after[0] * half, p[1] - after[1] * half);
+		}
+
+	}
+
+	if (closed) {
+		memcpy(&out[written * 2], out, 4 * sizeof(float));
+		written += 2;
+	}
+
+	return written;
+
+}
+
+float *shapeScratch(int slot, int floats) {
+
+	// Grows and is never freed, shapes don't get much bigger than the first few
+
+	if (floats > scratchSize[slot]) {
+
+		float *buffer = realloc(scratch[slot], floats * sizeof(float));
+		if (!buffer) return NULL;
+
+		scratch[slot] = buffer;
+		scratchSize[slot] = floats;
+
+	}
+
+	return scratch[slot];
+
+}
@@ -0,0 +1,55 @@
+// This code is licensed under the MIT Open Source License.
+
+// Copyright (c) 2015 Ruairidh Carmichael - ruairidhcarmichael@live.co.uk
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef SHAPE_H_INCLUDED
+#define SHAPE_H_INCLUDED
+
+#include <3ds.h>
+
+#define SHAPE_MIN_SEGMENTS 8
+#define SHAPE_MAX_SEGMENTS 256
+#define SHAPE_MITER_LIMIT 4 // Longest miter, in line widths, before it's clamped
+
+// Most points shapeStroke writes for a line of count points
+#define SHAPE_STROKE_POINTS(count) ((count) * 6 + 2)
+
+typedef enum {
+	SHAPE_JOIN_MITER,
+	SHAPE_JOIN_BEVEL,
+	SHAPE_JOIN_NONE
+} ShapeJoin;
+
+// Tessellation of the love.graphics shapes. Points are x, y float pairs.
+
+int shapeSegments(float radius);
+const float *shapeUnitCircle(int segments);
+
+void shapeEllipse(float *out, float x, float y, float rx, float ry, int segments);
+int shapeArc(float *out, float x, float y, float radius, float angle1, float angle2, int segments);
+
+bool shapeConvex(const float *points, int count);
+int shapeTriangulate(const float *points, int count, float *out);
+int shapeStroke(const float *points, int count, bool closed, float width, ShapeJoin join, float *out);
+
+float *shapeScratch(int slot, int floats);
+
+#endif
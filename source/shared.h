@@ -20,6 +20,9 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#ifndef SHARED_H_INCLUDED
+#define SHARED_H_INCLUDED
+
 #include "libs/lua/lua.h"
 #include "libs/lua/lualib.h"
 #include "libs/lua/lauxlib.h"
@@ -75,7 +78,15 @@ typedef enum {
 	TYPE_WAV = 1
 } love_source_type;
 
+// Load-time conversion of sample data
 typedef struct {
+	u32 rate; // 0 keeps the file's rate
+	u32 channels; // 0 keeps the file's channel count
+	int encoding; // -1 keeps the file's encoding
+} love_sample_options;
+
+// Decoded sample data, shared between sources and cached by path
+typedef struct love_sample {
 	love_source_type type;
 
 	float rate;
@@ -84,8 +95,33 @@ typedef struct {
 	u32 nsamples;
 	u32 size;
 	char* data;
+
+	u16 adpcmCoefs[16];
+	ndspAdpcmData adpcmData; // Initial decoder state
+
+	char *path; // Cache key, along with options
+	love_sample_options options;
+	int refs;
+	struct love_sample *next; // Next in the cache bucket
+} love_sample;
+
+typedef struct {
+	love_sample *sample;
+} love_sounddata;
+
+typedef struct {
+	love_sample *sample; // NULL for streaming sources
+	struct Stream *stream; // NULL for static sources
+
 	bool loop;
-	int audiochannel;
+	int audiochannel; // -1 while the source has no voice
+	int priority;
+	ndspWaveBuf waveBuf;
+	ndspAdpcmData adpcmData;
+
+	bool mixed; // Played through the software mixing bus
+	int mixvoice; // -1 while the source has no mixer voice
+	u32 mixgen;
 
 	float mix[12];
 	ndspInterpType interp;
@@ -98,6 +134,75 @@ typedef struct {
 	int height;
 } love_quad;
 
+#define PARTICLE_ARRAYS 10
+#define PARTICLE_MAX_SIZES 8
+#define PARTICLE_MAX_COLORS 8
+
+// Particles are kept as one array per attribute, all in a single block
+typedef struct {
+	love_image *image;
+	int imageRef; // Registry reference keeping the image alive
+
+	int capacity;
+	int count;
+	float *data; // PARTICLE_ARRAYS arrays of capacity floats
+	float *x, *y, *vx, *vy, *ax, *ay, *rotation, *spin, *life, *lifetime;
+
+	float emissionRate, emitCounter;
+	float emitterLifetime, emitterLife; // -1 emits forever
+	float lifeMin, lifeMax;
+	float speedMin, speedMax;
+	float direction, spread;
+	float accelMin[2], accelMax[2];
+	float rotationMin, rotationMax;
+	float spinMin, spinMax;
+
+	float sizes[PARTICLE_MAX_SIZES];
+	int sizeCount;
+	float colors[PARTICLE_MAX_COLORS][4];
+	int colorCount;
+
+	float x0, y0; // Emitter position
+	float ox, oy;
+
+	bool active, paused;
+	u32 seed;
+} love_particlesystem;
+
+typedef struct {
+	float x, y, u, v;
+	u32 color;
+} love_mesh_vertex;
+
+typedef struct {
+	void *data; // Packed vertices, then the vertex map, in linear memory
+	int indexCapacity;
+	float origin[2], unit; // Positions are packed as (p - origin) * unit
+	u32 drawnFrame; // sf2d frame it was last drawn in, 0 if never drawn
+} love_mesh_buffer;
+
+// Vertices and the vertex map are kept on the CPU and packed into a buffer for
+// the GPU. Frames are pipelined, so there are two buffers: one can be rewritten
+// while the GPU still reads the other.
+typedef struct {
+	love_image *image; // NULL draws vertex colors only
+	int imageRef;
+
+	GPU_Primitive_t mode;
+	int count;
+	love_mesh_vertex *vertices;
+
+	u16 *indices;
+	int indexCount; // 0 without a vertex map
+	int indexCapacity;
+
+	love_mesh_buffer buffers[2];
+	int current;
+	bool stale; // Changed while both buffers were in use, the current one is out of date
+
+	int rangeStart, rangeCount; // rangeCount 0 draws everything
+} love_mesh;
+
 extern lua_State *L;
 extern int currentScreen;
 extern int drawScreen;
@@ -109,7 +214,8 @@ extern love_font *currentFont;
 extern bool is3D;
 extern const char *fontDefaultInit();
 extern bool soundEnabled;
-extern bool channelList[24];
 extern u32 defaultFilter;
 extern const char *defaultMinFilter;
-extern const char *defaultMagFilter;
\ No newline at end of file
+extern const char *defaultMagFilter;
+
+#endif
@@ -0,0 +1,166 @@
+// This code is licensed under the MIT Open Source License.
+
+// Copyright (c) 2015 Ruairidh Carmichael - ruairidhcarmichael@live.co.uk
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+struct TraceEvent {
+
+	u64 tick;
+	const char *name; // String literal or interned
+	char phase; // 'B'egin or 'E'nd
+
+};
+
+static struct TraceEvent *events = NULL;
+static u32 eventCount = 0; // Events recorded, the ring holds the last TRACE_EVENTS
+static u64 traceStartTick = 0;
+static bool tracing = false;
+
+static char *names[TRACE_NAMES];
+static int nameCount = 0;
+
+static void traceRecord(const char *name, char phase) {
+
+	if (!tracing) return;
+
+	struct TraceEvent *event = &events[eventCount % TRACE_EVENTS];
+
+	event->tick = svcGetSystemTick();
+	event->name = name;
+	event->phase = phase;
+
+	eventCount++;
+
+}
+
+void traceBegin(const char *name) {
+
+	traceRecord(name, 'B');
+
+}
+
+void traceEnd(const char *name) {
+
+	traceRecord(name, 'E');
+
+}
+
+void traceZone(const char *name, int begin) { // sf2d zone callback
+
+	traceRecord(name, begin ? 'B' : 'E');
+
+}
+
+bool traceActive() {
+
+	return tracing;
+
+}
+
+const char *traceIntern(const char *name) { // Lua strings can be collected, zones keep a copy for good
+
+	for (int i = 0; i < nameCount; i++) {
+		if (strcmp(names[i], name) == 0) return names[i];
+	}
+
+	if (nameCount == TRACE_NAMES) return "(other zone)";
+
+	char *copy = strdup(name);
+	if (!copy) return "(other zone)";
+
+	names[nameCount++] = copy;
+
+	return copy;
+
+}
+
+void traceStart() {
+
+	if (!events) events = malloc(TRACE_EVENTS * sizeof(struct TraceEvent));
+	if (!events) return;
+
+	eventCount = 0;
+	traceStartTick = svcGetSystemTick();
+	tracing = true;
+
+}
+
+static void writeEscaped(FILE *file, const char *s) {
+
+	for (; *s; s++) {
+		unsigned char c = *s;
+		if (c == '"' || c == '\\') {
+			fputc('\\', file);
+			fputc(c, file);
+		} else if (c < 0x20) {
+			fprintf(file, "\\u%04x", c);
+		} else {
+			fputc(c, file);
+		}
+	}
+
+}
+
+int traceStop(const char *filename) { // Number of events written, -1 if the file can't be written
+
+	if (!tracing) return 0;
+
+	tracing = false;
+
+	FILE *file = fopen(filename, "w");
+	int written = -1;
+
+	if (file) {
+
+		u32 first = eventCount > TRACE_EVENTS ? eventCount - TRACE_EVENTS : 0;
+
+		fputs("{\"traceEvents\":[\n", file);
+
+		for (u32 i = first; i < eventCount; i++) {
+
+			struct TraceEvent *event = &events[i % TRACE_EVENTS];
+			double us = (event->tick - traceStartTick) * 1000000.0 / SYSCLOCK_ARM11;
+
+			fputs(i == first ? "{\"name\":\"" : ",\n{\"name\":\"", file);
+			writeEscaped(file, event->name);
+			fprintf(file, "\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":1}", event->phase, us);
+
+		}
+
+		fputs("\n],\"displayTimeUnit\":\"ms\"}\n", file);
+
+		written = ferror(file) ? -1 : (int)(eventCount - first);
+
+		if (fclose(file) != 0) written = -1;
+
+	}
+
+	free(events);
+	events = NULL;
+
+	return written;
+
+}
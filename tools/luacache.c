@@ -0,0 +1,118 @@
+// This code is licensed under the MIT Open Source License.
+
+// Copyright (c) 2015 Ruairidh Carmichael - ruairidhcarmichael@live.co.uk
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Precompiles every .lua file of a game directory into its bytecode
+// cache, so a release boots without parsing any Lua source.
+//
+// Lua bytecode depends on the word size and number type, so build it as
+// 32-bit from the repository root, with the same -DLUA_NUMBER_FLOAT
+// setting as the game, to match the 3DS:
+//
+//   gcc -m32 -O2 -Isource -o luacache tools/luacache.c source/bytecode.c $(ls source/libs/lua/*.c | grep -v print.c) -lm
+//
+//   ./luacache game
+//
+// The cache entries are written without the source mtime, so they stay
+// valid after the game is copied to the SD card (the hash is checked).
+
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "libs/lua/lua.h"
+#include "libs/lua/lauxlib.h"
+#include "bytecode.h"
+
+static int compiled = 0;
+static int failed = 0;
+
+static void compileDirectory(lua_State *L, const char *dir) {
+
+	DIR *d = opendir(dir);
+	if (!d) return;
+
+	struct dirent *entry;
+
+	while ((entry = readdir(d))) {
+
+		if (entry->d_name[0] == '.') continue; // Also skips the cache itself
+
+		// "main.lua" rather than "./main.lua", like the chunk names LovePotion uses
+		char path[1024];
+		if (strcmp(dir, ".") == 0) {
+			snprintf(path, sizeof(path), "%s", entry->d_name);
+		} else {
+			snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+		}
+
+		struct stat st;
+		if (stat(path, &st) != 0) continue;
+
+		if (S_ISDIR(st.st_mode)) {
+			compileDirectory(L, path);
+			continue;
+		}
+
+		size_t length = strlen(path);
+		if (length < 4 || strcmp(path + length - 4, ".lua") != 0) continue;
+
+		if (bytecodeCompile(L, path, 0) != 0) {
+			fprintf(stderr, "%s\n", lua_tostring(L, -1));
+			failed++;
+		} else {
+			compiled++;
+		}
+
+		lua_pop(L, 1);
+
+	}
+
+	closedir(d);
+
+}
+
+int main(int argc, char **argv) {
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s <game directory>\n", argv[0]);
+		return 1;
+	}
+
+	// Cache keys are paths relative to the game directory, as LovePotion sees them
+	if (chdir(argv[1]) != 0) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	lua_State *L = luaL_newstate();
+
+	compileDirectory(L, ".");
+
+	lua_close(L);
+
+	printf("%d files compiled into %s/" BYTECODE_CACHE_DIR ", %d failed\n", compiled, argv[1], failed);
+
+	return failed != 0;
+
+}
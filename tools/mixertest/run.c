@@ -0,0 +1,297 @@
+// This code is licensed under the MIT Open Source License.
+
+// Copyright (c) 2015 Ruairidh Carmichael - ruairidhcarmichael@live.co.uk
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Host unit test for the software mixing bus: source/mixer.c is built
+// against the stand-ins below and its output is compared with a float
+// reference mixer. From the repository root:
+//
+//   gcc -O1 -fsanitize=address,undefined -o mixertest tools/mixertest/run.c -lm
+//   ./mixertest
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Stand-ins for shared.h and util.h, with just what mixer.c uses
+#define SHARED_H_INCLUDED
+#define UTIL_H_INCLUDED
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef int LightLock;
+
+enum { NDSP_ENCODING_PCM8, NDSP_ENCODING_PCM16, NDSP_ENCODING_ADPCM };
+enum { NDSP_INTERP_NONE = 2, NDSP_FORMAT_STEREO_PCM16 = 6 };
+enum { NDSP_WBUF_FREE, NDSP_WBUF_QUEUED, NDSP_WBUF_PLAYING, NDSP_WBUF_DONE };
+
+typedef struct {
+	s16 *data_pcm16;
+	u32 nsamples;
+	u8 status;
+} ndspWaveBuf;
+
+typedef struct love_sample {
+	float rate;
+	u32 channels;
+	u32 encoding;
+	u32 nsamples;
+	char *data;
+	int refs;
+} love_sample;
+
+bool soundEnabled = true;
+int voiceCount = 24;
+
+void voiceRelease(int channel) { }
+void sampleRetain(love_sample *self) { self->refs++; }
+void sampleRelease(love_sample *self) { self->refs--; }
+
+void *linearAlloc(size_t size) { return malloc(size); }
+void DSP_FlushDataCache(const void *data, u32 size) { }
+void LightLock_Init(LightLock *lock) { *lock = 0; }
+void LightLock_Lock(LightLock *lock) { (*lock)++; }
+void LightLock_Unlock(LightLock *lock) { (*lock)--; }
+void ndspChnReset(int channel) { }
+void ndspChnInitParams(int channel) { }
+void ndspChnSetMix(int channel, float *mix) { }
+void ndspChnSetInterp(int channel, int type) { }
+void ndspChnSetRate(int channel, float rate) { }
+void ndspChnSetFormat(int channel, u16 format) { }
+void ndspChnWaveBufAdd(int channel, ndspWaveBuf *buf) { }
+void ndspSetCallback(void (*callback)(void *), void *data) { }
+
+#include "../../source/mixer.c"
+
+// Float reference: every voice reads frame (t * step) >> 16 of its sample,
+// the same 16.16 walk as the bus, and is clamped before and after it's
+// added, like the bus's saturating adds
+struct RefVoice {
+
+	love_sample *sample;
+	float gainL, gainR;
+	bool loop;
+	u32 step;
+	uint64_t t; // Output frames rendered so far
+
+};
+
+static float clamp16(float x) {
+
+	return fminf(fmaxf(x, -32768), 32767);
+
+}
+
+static void refRender(struct RefVoice *voices, int count, float *out, int frames) {
+
+	for (int i = 0; i < frames; i++) {
+
+		float l = 0, r = 0;
+
+		for (int v = 0; v < count; v++) {
+
+			struct RefVoice *voice = &voices[v];
+			const s16 *data = (const s16 *)voice->sample->data;
+			u32 stride = voice->sample->channels;
+			uint64_t pos = (voice->t++ * voice->step) >> 16;
+
+			if (pos >= voice->sample->nsamples) {
+				if (!voice->loop) continue;
+				pos %= voice->sample->nsamples;
+			}
+
+			l = clamp16(l + clamp16(data[pos * stride] * voice->gainL));
+			r = clamp16(r + clamp16(data[pos * stride + stride - 1] * voice->gainR));
+
+		}
+
+		out[i * 2] = l;
+		out[i * 2 + 1] = r;
+
+	}
+
+}
+
+static int failures = 0;
+
+static love_sample *makeSample(float rate, u32 channels, u32 nsamples, unsigned seed) {
+
+	love_sample *sample = calloc(1, sizeof(love_sample));
+	s16 *data = malloc(nsamples * channels * sizeof(s16) + 1);
+
+	srand(seed);
+	for (u32 i = 0; i < nsamples * channels; i++) data[i] = (rand() & 0xFFFF) - 32768;
+
+	sample->rate = rate;
+	sample->channels = channels;
+	sample->encoding = NDSP_ENCODING_PCM16;
+	sample->nsamples = nsamples;
+	sample->data = (char *)data;
+
+	return sample;
+
+}
+
+static void freeSample(love_sample *sample) {
+
+	free(sample->data);
+	free(sample);
+
+}
+
+// Plays every sample on the bus and on the reference, then compares blocks
+// of the given sizes. The bus rounds each voice's gain and product down,
+// so it may be off by up to one step per voice.
+static void check(const char *name, love_sample **samples, const float *gains, bool loop, int count, const int *blocks, int nblocks) {
+
+	struct RefVoice ref[MIXER_VOICES];
+	s16 out[MIXER_FRAMES * 2];
+	float expected[MIXER_FRAMES * 2];
+	int worst = 0;
+
+	mixerStopAll();
+
+	for (int v = 0; v < count; v++) {
+
+		u32 generation;
+
+		if (mixerPlay(samples[v], gains[v * 2], gains[v * 2 + 1], loop, &generation) == -1) {
+			printf("FAIL %s: voice %d did not start\n", name, v);
+			failures++;
+			return;
+		}
+
+		ref[v].sample = samples[v];
+		ref[v].gainL = gains[v * 2];
+		ref[v].gainR = gains[v * 2 + 1];
+		ref[v].loop = loop;
+		ref[v].step = (u32)(samples[v]->rate * 65536.0f / MIXER_RATE);
+		ref[v].t = 0;
+
+	}
+
+	for (int b = 0; b < nblocks; b++) {
+
+		mixerRender(out, blocks[b]);
+		refRender(ref, count, expected, blocks[b]);
+
+		for (int i = 0; i < blocks[b] * 2; i++) {
+			int error = abs(out[i] - (int)floorf(expected[i]));
+			if (error > worst) worst = error;
+		}
+
+	}
+
+	if (worst > count + 1) {
+		printf("FAIL %s: off by %d\n", name, worst);
+		failures++;
+	}
+
+}
+
+int main(int argc, char **argv) {
+
+	static const int one[] = { MIXER_FRAMES };
+	static const int uneven[] = { 1, 7, MIXER_FRAMES, 100, 3, MIXER_FRAMES, MIXER_FRAMES, 64 };
+	static const float unity[] = { 1, 1 };
+	static const float panned[] = { 0.25f, 0.9f };
+	static const float loud[] = { 3.5f, -12 };
+
+	love_sample *mono = makeSample(MIXER_RATE, 1, 3000, 1);
+	love_sample *stereo = makeSample(MIXER_RATE, 2, 3000, 2);
+	love_sample *slow = makeSample(22050, 2, 700, 3);
+	love_sample *fast = makeSample(48000, 1, 900, 4);
+	love_sample *tiny = makeSample(44100, 1, 1, 5);
+
+	check("mono copy", &mono, unity, false, 1, one, 1);
+	check("stereo panned", &stereo, panned, false, 1, uneven, 8);
+	check("resampled down", &slow, panned, false, 1, uneven, 8);
+	check("resampled up", &fast, unity, false, 1, uneven, 8);
+	check("looping", &slow, unity, true, 1, uneven, 8);
+	check("one frame loop", &tiny, panned, true, 1, uneven, 8);
+	check("loud and inverted", &stereo, loud, false, 1, uneven, 8);
+
+	// Every voice at once, loud enough to clip
+	love_sample *many[MIXER_VOICES];
+	float gains[MIXER_VOICES * 2];
+
+	for (int v = 0; v < MIXER_VOICES; v++) {
+		many[v] = makeSample(8000 + v * 1500, 1 + v % 2, 200 + v * 37, 10 + v);
+		gains[v * 2] = (v % 5) * 0.25f;
+		gains[v * 2 + 1] = 1 - (v % 3) * 0.3f;
+	}
+
+	check("all voices", many, gains, true, MIXER_VOICES, uneven, 8);
+
+	// A voice that ran out stops and leaves silence
+	s16 out[MIXER_FRAMES * 2];
+	u32 generation;
+
+	mixerStopAll();
+	int slot = mixerPlay(mono, 1, 1, false, &generation);
+	for (int i = 0; i < 8; i++) mixerRender(out, MIXER_FRAMES);
+
+	if (mixerIsPlaying(slot, generation) || mixerActiveCount() != 0) {
+		printf("FAIL finished voice is still playing\n");
+		failures++;
+	}
+
+	for (int i = 0; i < MIXER_FRAMES * 2; i++) {
+		if (out[i] != 0) {
+			printf("FAIL finished voice is not silent\n");
+			failures++;
+			break;
+		}
+	}
+
+	// Empty samples are turned away instead of dividing by zero
+	love_sample *empty = makeSample(MIXER_RATE, 1, 0, 6);
+
+	if (mixerPlay(empty, 1, 1, true, &generation) != -1) {
+		printf("FAIL empty sample started\n");
+		failures++;
+	}
+
+	mixerRender(out, MIXER_FRAMES);
+	mixerStopAll();
+
+	freeSample(mono);
+	freeSample(stereo);
+	freeSample(slow);
+	freeSample(fast);
+	freeSample(tiny);
+	freeSample(empty);
+	for (int v = 0; v < MIXER_VOICES; v++) freeSample(many[v]);
+	free(mixerBuffer);
+
+	printf(failures == 0 ? "mixer ok\n" : "%d mixer checks failed\n", failures);
+
+	return failures != 0;
+
+}
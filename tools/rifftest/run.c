@@ -0,0 +1,295 @@
+// This code is licensed under the MIT Open Source License.
+
+// Copyright (c) 2015 Ruairidh Carmichael - ruairidhcarmichael@live.co.uk
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Host tests for the WAV parser in source/riff.c: hand-made damaged files
+// first, then random mutations of a good one. From the repository root:
+//
+//   gcc -O1 -fsanitize=address,undefined -Itools/rifftest -o rifftest tools/rifftest/run.c source/riff.c
+//   ./rifftest
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../source/riff.h"
+
+#define FUZZ_RUNS 20000
+
+static u8 file[4096];
+static u32 fileLen;
+static char path[] = "/tmp/rifftestXXXXXX";
+static int failures = 0;
+
+static void put(const void *data, u32 size) {
+
+	memcpy(file + fileLen, data, size);
+	fileLen += size;
+
+}
+
+static void put16(u32 v) {
+
+	u8 b[2] = { v, v >> 8 };
+	put(b, 2);
+
+}
+
+static void put32(u32 v) {
+
+	u8 b[4] = { v, v >> 8, v >> 16, v >> 24 };
+	put(b, 4);
+
+}
+
+static void chunk(const char *id, u32 size) {
+
+	put(id, 4);
+	put32(size);
+
+}
+
+// The RIFF size is patched by finish() unless a case sets it
+static void begin() {
+
+	fileLen = 0;
+	chunk("RIFF", 0);
+	put("WAVE", 4);
+
+}
+
+static void fmt(u32 size, u16 format, u16 channels, u32 rate, u16 bits) {
+
+	chunk("fmt ", size);
+	put16(format);
+	put16(channels);
+	put32(rate);
+	put32(rate * channels * bits / 8);
+	put16(channels * bits / 8);
+	put16(bits);
+
+	for (u32 i = 16; i < size + (size & 1); i++) put("\0", 1);
+
+}
+
+static void data(u32 size, u32 present) {
+
+	chunk("data", size);
+	for (u32 i = 0; i < present; i++) put(&(u8){ i * 7 }, 1);
+
+}
+
+static void setRiffSize(u32 size) {
+
+	u8 *p = file + 4;
+	p[0] = size; p[1] = size >> 8; p[2] = size >> 16; p[3] = size >> 24;
+
+}
+
+static void finish() {
+
+	setRiffSize(fileLen - 8);
+
+}
+
+static const char *parse(struct WavInfo *info, u32 *readable) {
+
+	FILE *f = fopen(path, "wb");
+	fwrite(file, 1, fileLen, f);
+	fclose(f);
+
+	struct RiffReader reader;
+	const char *error = wavOpen(&reader, info, path);
+
+	if (!error) {
+		// Reading the whole chunk must stop at the end of the file
+		u8 *buffer = malloc(info->dataSize < 65536 ? info->dataSize + 1 : 65536);
+		*readable = riffRead(&reader, buffer, info->dataSize < 65536 ? info->dataSize : 65536);
+		free(buffer);
+		riffClose(&reader);
+	}
+
+	return error;
+
+}
+
+static void expect(const char *name, const char *error, u32 dataOffset, u32 dataSize, u32 readable) {
+
+	struct WavInfo info;
+	u32 got = 0;
+	const char *result = parse(&info, &got);
+
+	if (error || result) {
+		if (!error || !result || strcmp(error, result) != 0) {
+			printf("FAIL %s: got \"%s\", expected \"%s\"\n", name, result ? result : "ok", error ? error : "ok");
+			failures++;
+		}
+		return;
+	}
+
+	if (info.dataOffset != dataOffset || info.dataSize != dataSize || got != readable) {
+		printf("FAIL %s: data at %u, %u bytes, %u readable, expected %u, %u, %u\n",
+			name, info.dataOffset, info.dataSize, got, dataOffset, dataSize, readable);
+		failures++;
+	}
+
+}
+
+static const char *noData = "reached EOF before finding a data chunk";
+
+static void cases() {
+
+	begin(); fmt(16, 1, 2, 44100, 16); data(64, 64); finish();
+	expect("plain", NULL, 44, 64, 64);
+
+	begin(); fmt(16, 1, 1, 22050, 8); chunk("LIST", 5); put("abcde\0", 6); data(10, 10); finish();
+	expect("odd chunk is padded", NULL, 58, 10, 10);
+
+	begin(); fmt(17, 1, 1, 22050, 8); data(10, 10); finish();
+	expect("odd fmt size", NULL, 46, 10, 10);
+
+	begin(); fmt(16, 1, 2, 44100, 16); data(3, 3); put("\0", 1); finish();
+	expect("odd data size", NULL, 44, 3, 3);
+
+	begin(); fmt(40, 0xFFFE, 2, 44100, 16); file[fileLen - 16] = 1; data(8, 8); finish();
+	expect("extensible", NULL, 68, 8, 8);
+
+	// Truncated at every level
+	begin(); fileLen = 6;
+	expect("truncated RIFF header", "RIFF chunk not found", 0, 0, 0);
+
+	begin(); fmt(16, 1, 2, 44100, 16); finish(); fileLen = 30;
+	expect("truncated fmt", "fmt chunk is truncated", 0, 0, 0);
+
+	begin(); fmt(16, 1, 2, 44100, 16); data(0, 0); finish(); fileLen -= 4;
+	expect("truncated chunk header", noData, 0, 0, 0);
+
+	begin(); fmt(16, 1, 2, 44100, 16); data(1000, 100); setRiffSize(36 + 1000);
+	expect("truncated data", NULL, 44, 1000, 100);
+
+	begin(); fmt(16, 1, 2, 44100, 16); data(1000, 100); finish();
+	expect("form shorter than data", NULL, 44, 100, 100);
+
+	// Sizes near the 32-bit limit
+	begin(); fmt(16, 1, 2, 44100, 16); data(64, 64); setRiffSize(0xFFFFFFFF);
+	expect("huge RIFF size", NULL, 44, 64, 64);
+
+	begin(); fmt(16, 1, 2, 44100, 16); data(0xFFFFFFFF, 64); setRiffSize(0xFFFFFFFF);
+	expect("huge data size", NULL, 44, 0xFFFFFFFF - 44, 64);
+
+	begin(); fmt(16, 1, 2, 44100, 16); data(0xFFFFFFF0, 64); finish();
+	expect("huge data size in a small form", NULL, 44, 64, 64);
+
+	// Skipping this one would wrap back onto its own header, forever
+	begin(); fmt(16, 1, 2, 44100, 16); chunk("junk", 0xFFFFFFF8); data(8, 8); setRiffSize(0xFFFFFFFF);
+	expect("huge chunk wraps around", noData, 0, 0, 0);
+
+	begin(); chunk("fmt ", 0x7FFFFFFF); put16(1); put16(2); put32(44100); put32(176400); put16(4); put16(16); data(8, 8); finish();
+	expect("huge fmt size", "fmt chunk is truncated", 0, 0, 0);
+
+	// Missing or misplaced chunks
+	begin(); data(8, 8); fmt(16, 1, 2, 44100, 16); finish();
+	expect("data before fmt", "fmt chunk not found", 0, 0, 0);
+
+	begin(); fmt(16, 1, 2, 44100, 16); finish();
+	expect("no data", noData, 0, 0, 0);
+
+	begin(); chunk("LIST", 4); put("INFO", 4); finish();
+	expect("no chunks we know", noData, 0, 0, 0);
+
+	begin(); finish();
+	expect("empty form", noData, 0, 0, 0);
+
+	begin(); fmt(16, 1, 2, 44100, 16); data(8, 8); setRiffSize(28);
+	expect("data past the form", noData, 0, 0, 0);
+
+	begin(); memcpy(file + 8, "AVI ", 4); fmt(16, 1, 2, 44100, 16); data(8, 8); finish();
+	expect("not WAVE", "RIFF not in WAVE format", 0, 0, 0);
+
+	begin(); fmt(16, 1, 3, 44100, 16); data(8, 8); finish();
+	expect("three channels", "WAV needs to be mono or stereo", 0, 0, 0);
+
+	begin(); fmt(16, 1, 2, 44100, 16); file[32] = 3; data(8, 8); finish();
+	expect("bad block align", "WAV has a bad block alignment", 0, 0, 0);
+
+}
+
+// Whatever the damage, a parsed file has to describe data inside the form
+static void fuzz() {
+
+	static const u8 interesting[] = { 0x00, 0x01, 0x02, 0x7F, 0x80, 0xFE, 0xFF };
+
+	srand(1);
+
+	for (int run = 0; run < FUZZ_RUNS; run++) {
+
+		begin();
+		fmt(16 + (run % 3) * 9, run % 7 ? 1 : 0xFFFE, 1 + run % 2, 8000 + run, run % 4 ? 16 : 8);
+		if (run % 5 == 0) { chunk("LIST", 3); put("ab\0\0", 4); }
+		data(256 + run % 3, 256 + run % 3);
+		finish();
+
+		for (int n = 1 + rand() % 4; n > 0; n--) {
+			u32 at = rand() % fileLen;
+			file[at] = rand() % 2 ? interesting[rand() % sizeof(interesting)] : rand();
+		}
+
+		if (rand() % 3 == 0) fileLen = rand() % fileLen;
+
+		struct WavInfo info;
+		u32 readable = 0;
+
+		if (parse(&info, &readable)) continue;
+
+		u32 formEnd = file[4] | (file[5] << 8) | (file[6] << 16) | ((u32)file[7] << 24);
+		formEnd = formEnd > 0xFFFFFFFF - 8 ? 0xFFFFFFFF : formEnd + 8;
+
+		if (info.channels < 1 || info.channels > 2 || info.blockAlign != info.channels * info.bitsPerSample / 8 ||
+			info.dataOffset < 20 || info.dataSize > formEnd - info.dataOffset ||
+			readable > fileLen - (info.dataOffset < fileLen ? info.dataOffset : fileLen)) {
+			printf("FAIL fuzz run %d: data at %u, %u bytes\n", run, info.dataOffset, info.dataSize);
+			failures++;
+		}
+
+	}
+
+}
+
+int main(int argc, char **argv) {
+
+	int fd = mkstemp(path);
+	if (fd == -1) {
+		perror("rifftest");
+		return 1;
+	}
+	close(fd);
+
+	cases();
+	fuzz();
+
+	remove(path);
+
+	printf(failures == 0 ? "riff ok\n" : "%d riff checks failed\n", failures);
+
+	return failures != 0;
+
+}
@@ -0,0 +1,102 @@
+-- Lua VM micro benchmarks, run on the host with tools/vmbench/run.c
+-- or on the device from a game's main.lua with dofile("bench.lua").
+-- Each benchmark reports the best of a few runs in milliseconds.
+
+local benchmarks = {}
+
+local function bench(name, fn)
+	benchmarks[#benchmarks + 1] = { name = name, fn = fn }
+end
+
+bench("fib", function()
+	local function fib(n)
+		if n < 2 then return n end
+		return fib(n - 1) + fib(n - 2)
+	end
+	return fib(27)
+end)
+
+bench("table", function()
+	local t = {}
+	for i = 1, 300000 do t[i] = i * 2 end
+	local sum = 0
+	for i = 1, #t do sum = sum + t[i] end
+	local h = {}
+	for i = 1, 20000 do h["k" .. (i % 1000)] = i end
+	local points = {}
+	for i = 1, 20000 do points[i] = { x = i, y = -i } end
+	for i = 1, #points do local p = points[i]; p.x = p.x + p.y end
+	return sum
+end)
+
+bench("string", function()
+	local parts = {}
+	for i = 1, 20000 do
+		parts[#parts + 1] = string.format("%d:%s", i, "item")
+	end
+	local s = table.concat(parts, ",")
+	local count = 0
+	for _ in s:gmatch("%d+:item") do count = count + 1 end
+	local acc = ""
+	for i = 1, 2000 do acc = acc .. "x" end
+	return count + #acc
+end)
+
+bench("closure", function()
+	local total = 0
+	for i = 1, 300000 do
+		local f = function(x) return x + i end
+		total = total + f(1)
+	end
+	local function counter()
+		local n = 0
+		return function() n = n + 1; return n end
+	end
+	local c = counter()
+	for i = 1, 300000 do c() end
+	return total + c()
+end)
+
+bench("lookup", function()
+	-- What a love.draw full of love.graphics calls does
+	love = love or {}
+	love.graphics = love.graphics or {}
+	local g = love.graphics
+	g.setColor = g.setColor or function() end
+	g.draw = g.draw or function() end
+	g.rectangle = g.rectangle or function() end
+	local sprite = { x = 0, y = 0, image = {} }
+	for i = 1, 100000 do
+		love.graphics.setColor(255, 255, 255)
+		love.graphics.draw(sprite.image, sprite.x, sprite.y)
+		love.graphics.rectangle("fill", sprite.x, sprite.y, 8, 8)
+	end
+end)
+
+bench("number", function()
+	-- Pixel maths: wrapping, squared distances, score strings
+	local acc, text = 0, nil
+	for i = 1, 200000 do
+		local x, y = i % 400, i % 240
+		acc = acc + (x - 200)^2 + (y - 120)^2
+		if i % 64 == 0 then text = "score " .. i end
+	end
+	return acc, text
+end)
+
+local results = {}
+
+for _, b in ipairs(benchmarks) do
+	local best = math.huge
+	for run = 1, 5 do
+		local start = os.clock()
+		b.fn()
+		local elapsed = os.clock() - start
+		if elapsed < best then best = elapsed end
+	end
+	results[#results + 1] = string.format("%-10s %8.2f ms", b.name, best * 1000)
+end
+
+print(table.concat(results, "\n"))
+
+return results
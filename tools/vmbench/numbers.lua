@@ -0,0 +1,66 @@
+-- Number conformance checks for the VM's number configuration and
+-- integer fast paths. Run like bench.lua; works with double and
+-- LUA_NUMBER_FLOAT builds (the double-only checks are skipped).
+
+local double = 2^24 + 1 ~= 2^24
+
+local failures = 0
+
+local function check(name, got, expected)
+	if got ~= expected and not (got ~= got and expected ~= expected) then
+		failures = failures + 1
+		print(string.format("FAIL %s: got %s, expected %s", name, tostring(got), tostring(expected)))
+	end
+end
+
+-- Modulo follows floor division for every sign combination
+for a = -9, 9 do
+	for _, b in ipairs({ 1, 2, 3, 4, 7, 8, -2, -3, 0.5 }) do
+		check(a .. " % " .. b, a % b, a - math.floor(a / b) * b)
+	end
+end
+check("5.5 % 2", 5.5 % 2, 1.5)
+check("-5.5 % 2", -5.5 % 2, 0.5)
+check("x % 0 is nan", (1 % 0) ~= (1 % 0), true)
+
+-- Powers
+for _, x in ipairs({ -3, -0.5, 0, 1.5, 7, 1e10 }) do
+	check(x .. "^2", x ^ 2, x * x)
+end
+check("2^10", 2 ^ 10, 1024)
+check("4^0.5", 4 ^ 0.5, 2)
+check("2^-1", 2 ^ -1, 0.5)
+
+-- Integers and floats turn into the same strings as with %.14g
+check("tostring 0", tostring(0), "0")
+check("tostring -0", tostring(-0.0 * 1), string.format("%.14g", -0.0))
+check("tostring 42", tostring(42), "42")
+check("tostring -7", tostring(-7), "-7")
+check("tostring 2^31-1", tostring(2^31 - 1), double and "2147483647" or string.format("%.7g", 2^31 - 1))
+check("tostring -2^31", tostring(-2^31), double and "-2147483648" or "-2.147484e+09")
+check("tostring 9999999", tostring(9999999), "9999999")
+check("tostring 1e7", tostring(1e7), double and "10000000" or "1e+07")
+check("tostring -1e7", tostring(-1e7), double and "-10000000" or "-1e+07")
+check("tostring 0.5", tostring(0.5), "0.5")
+check("concat", 10 .. "px", "10px")
+check("tostring inf", tostring(1/0), string.format("%.14g", 1/0))
+
+if double then
+	check("2^31 % 3", 2^31 % 3, 2)
+	check("tostring 1e100", tostring(1e100), "1e+100")
+	check("tostring 2^31", tostring(2^31), "2147483648")
+	check("tostring 2^53", tostring(2^53), "9.007199254741e+15")
+	check("2^53 + 1", 2^53 + 1, 2^53)
+else
+	check("float 2^24 + 1", 2^24 + 1, 2^24)
+end
+
+-- Numbers from strings and the for loop
+check("tonumber", tonumber("0x10") + tonumber("1.5e1"), 31)
+local sum = 0
+for i = 1, 10, 0.5 do sum = sum + i end
+check("float for", sum, 104.5)
+
+print(failures == 0 and "numbers ok" or (failures .. " number checks failed"))
+
+return failures
@@ -0,0 +1,54 @@
+// This code is licensed under the MIT Open Source License.
+
+// Copyright (c) 2015 Ruairidh Carmichael - ruairidhcarmichael@live.co.uk
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Host runner for the Lua VM benchmarks, built from the vendored Lua so
+// VM changes can be compared without a device. From the repository root:
+//
+//   gcc -O2 -Isource/libs/lua -o vmbench tools/vmbench/run.c $(ls source/libs/lua/*.c | grep -v print.c) -lm
+//   ./vmbench tools/vmbench/bench.lua
+//
+// Add -DLUA_NO_COMPUTED_GOTO to measure the switch dispatch, or
+// -DLUA_NUMBER_FLOAT for the single-precision configuration; numbers.lua
+// checks number semantics under either.
+
+#include <stdio.h>
+
+#include "lua.h"
+#include "lualib.h"
+#include "lauxlib.h"
+
+int main(int argc, char **argv) {
+
+	const char *script = argc > 1 ? argv[1] : "tools/vmbench/bench.lua";
+
+	lua_State *L = luaL_newstate();
+	luaL_openlibs(L);
+
+	int status = luaL_dofile(L, script);
+
+	if (status) fprintf(stderr, "%s\n", lua_tostring(L, -1));
+
+	lua_close(L);
+
+	return status != 0;
+
+}